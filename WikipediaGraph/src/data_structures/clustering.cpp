@@ -0,0 +1,244 @@
+#include "clustering.h"
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+    constexpr int maxPasses = 32;
+    constexpr double minGain = 1e-12;
+    constexpr std::size_t parallelThreshold = 2048; // Меньшие графы быстрее обработать в одном потоке
+
+    struct WeightedGraph
+    {
+        std::vector<std::vector<std::pair<int, double>>> adjacency;
+        std::vector<double> selfLoops;
+
+        int size() const { return static_cast<int>(adjacency.size()); }
+    };
+
+    // Ожидаемый прирост модулярности при переносе узла в сообщество без учёта общего множителя
+    double gain(double weightToCommunity, double communityTotal, double degree, double totalWeight)
+    {
+        return weightToCommunity - communityTotal * degree / totalWeight;
+    }
+
+    double weightTo(const WeightedGraph &graph, const std::vector<int> &community, int node, int target)
+    {
+        double weight = 0.0;
+        for (const auto &[neighbor, w] : graph.adjacency[node])
+        {
+            if (neighbor != node && community[neighbor] == target)
+                weight += w;
+        }
+        return weight;
+    }
+
+    // Фаза локальных перемещений: предложения считаются параллельно по снимку
+    // сообществ, затем применяются последовательно с перепроверкой прироста.
+    void moveNodes(const WeightedGraph &graph, std::vector<int> &community)
+    {
+        int n = graph.size();
+        std::vector<double> degree(n), total(n);
+        double totalWeight = 0.0;
+        for (int i = 0; i < n; ++i)
+        {
+            degree[i] = 2.0 * graph.selfLoops[i];
+            for (const auto &[neighbor, w] : graph.adjacency[i])
+                degree[i] += w;
+            total[community[i]] += degree[i];
+            totalWeight += degree[i];
+        }
+        if (totalWeight == 0.0)
+            return;
+
+        std::vector<int> proposal(n);
+        auto propose = [&](int from, int to)
+        {
+            std::vector<double> weights(n, 0.0);
+            std::vector<int> touched;
+            for (int i = from; i < to; ++i)
+            {
+                for (const auto &[neighbor, w] : graph.adjacency[i])
+                {
+                    if (neighbor == i)
+                        continue;
+                    int c = community[neighbor];
+                    if (weights[c] == 0.0)
+                        touched.push_back(c);
+                    weights[c] += w;
+                }
+
+                int own = community[i];
+                int best = own;
+                double bestGain = gain(weights[own], total[own] - degree[i], degree[i], totalWeight);
+                for (int c : touched)
+                {
+                    double g = gain(weights[c], total[c], degree[i], totalWeight);
+                    if (c != own && g > bestGain + minGain)
+                    {
+                        best = c;
+                        bestGain = g;
+                    }
+                }
+                proposal[i] = best;
+
+                for (int c : touched)
+                    weights[c] = 0.0;
+                touched.clear();
+            }
+        };
+
+        unsigned threads = n < static_cast<int>(parallelThreshold) ? 1 : std::max(1u, std::thread::hardware_concurrency());
+        for (int pass = 0; pass < maxPasses; ++pass)
+        {
+            if (threads == 1)
+            {
+                propose(0, n);
+            }
+            else
+            {
+                std::vector<std::thread> workers;
+                int chunk = (n + static_cast<int>(threads) - 1) / static_cast<int>(threads);
+                for (int from = 0; from < n; from += chunk)
+                    workers.emplace_back(propose, from, std::min(n, from + chunk));
+                for (auto &worker : workers)
+                    worker.join();
+            }
+
+            int moved = 0;
+            for (int i = 0; i < n; ++i)
+            {
+                int own = community[i];
+                int target = proposal[i];
+                if (target == own)
+                    continue;
+                double stay = gain(weightTo(graph, community, i, own), total[own] - degree[i], degree[i], totalWeight);
+                double move = gain(weightTo(graph, community, i, target), total[target], degree[i], totalWeight);
+                if (move > stay + minGain)
+                {
+                    total[own] -= degree[i];
+                    total[target] += degree[i];
+                    community[i] = target;
+                    ++moved;
+                }
+            }
+            if (moved == 0)
+                break;
+        }
+    }
+
+    int renumber(std::vector<int> &community)
+    {
+        std::unordered_map<int, int> ids;
+        for (int &c : community)
+        {
+            auto [it, inserted] = ids.try_emplace(c, static_cast<int>(ids.size()));
+            c = it->second;
+        }
+        return static_cast<int>(ids.size());
+    }
+
+    WeightedGraph aggregate(const WeightedGraph &graph, const std::vector<int> &community, int count)
+    {
+        WeightedGraph result;
+        result.adjacency.resize(count);
+        result.selfLoops.assign(count, 0.0);
+
+        std::vector<std::unordered_map<int, double>> weights(count);
+        for (int i = 0; i < graph.size(); ++i)
+        {
+            int from = community[i];
+            result.selfLoops[from] += graph.selfLoops[i];
+            for (const auto &[neighbor, w] : graph.adjacency[i])
+            {
+                int to = community[neighbor];
+                if (from == to)
+                    result.selfLoops[from] += w / 2.0; // Каждое внутреннее ребро встречается дважды
+                else
+                    weights[from][to] += w;
+            }
+        }
+        for (int c = 0; c < count; ++c)
+            result.adjacency[c].assign(weights[c].begin(), weights[c].end());
+        return result;
+    }
+}
+
+void ClusterHierarchy::clear()
+{
+    nodeIndex.clear();
+    nodeCluster.clear();
+    clusterCounts.clear();
+    levelOffsets.clear();
+}
+
+void ClusterHierarchy::build(const std::vector<int> &nodeIds, const std::vector<std::pair<int, int>> &links)
+{
+    clear();
+    for (int id : nodeIds)
+        nodeIndex.try_emplace(id, static_cast<int>(nodeIndex.size()));
+
+    WeightedGraph graph;
+    graph.adjacency.resize(nodeIndex.size());
+    graph.selfLoops.assign(nodeIndex.size(), 0.0);
+    for (const auto &[fromId, toId] : links)
+    {
+        auto from = nodeIndex.find(fromId);
+        auto to = nodeIndex.find(toId);
+        if (from == nodeIndex.end() || to == nodeIndex.end())
+            continue;
+        if (from->second == to->second)
+        {
+            graph.selfLoops[from->second] += 1.0;
+            continue;
+        }
+        graph.adjacency[from->second].emplace_back(to->second, 1.0);
+        graph.adjacency[to->second].emplace_back(from->second, 1.0);
+    }
+
+    std::vector<int> current(nodeIndex.size());
+    for (std::size_t i = 0; i < current.size(); ++i)
+        current[i] = static_cast<int>(i);
+
+    while (graph.size() > 1)
+    {
+        std::vector<int> community(graph.size());
+        for (int i = 0; i < graph.size(); ++i)
+            community[i] = i;
+        moveNodes(graph, community);
+
+        int count = renumber(community);
+        if (count == graph.size())
+            break;
+
+        for (int &c : current)
+            c = community[c];
+        nodeCluster.push_back(current);
+        levelOffsets.push_back(levelOffsets.empty() ? 0 : levelOffsets.back() + clusterCounts.back());
+        clusterCounts.push_back(count);
+
+        graph = aggregate(graph, community, count);
+    }
+}
+
+std::optional<int> ClusterHierarchy::clusterOf(int nodeId, int level) const
+{
+    auto it = nodeIndex.find(nodeId);
+    if (it == nodeIndex.end() || level < 0 || level >= levels())
+        return std::nullopt;
+    return nodeCluster[level][it->second];
+}
+
+std::optional<ClusterHierarchy::ClusterKey> ClusterHierarchy::collapsedAncestor(int nodeId, const std::set<ClusterKey> &expanded) const
+{
+    auto it = nodeIndex.find(nodeId);
+    if (it == nodeIndex.end())
+        return std::nullopt;
+    for (int level = levels() - 1; level >= 0; --level)
+    {
+        ClusterKey key{level, nodeCluster[level][it->second]};
+        if (!expanded.count(key))
+            return key;
+    }
+    return std::nullopt;
+}
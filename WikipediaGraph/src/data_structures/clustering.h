@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Иерархия сообществ, найденная алгоритмом Louvain. Уровень 0 — самые мелкие
+// кластеры из исходных статей, каждый следующий уровень объединяет кластеры
+// предыдущего. Кластер задаётся парой (уровень, номер на уровне).
+class ClusterHierarchy
+{
+public:
+    using ClusterKey = std::pair<int, int>;
+
+    void build(const std::vector<int> &nodeIds, const std::vector<std::pair<int, int>> &links);
+    void clear();
+
+    int levels() const { return static_cast<int>(clusterCounts.size()); }
+    int clusterCount(int level) const { return clusterCounts[level]; }
+    std::optional<int> clusterOf(int nodeId, int level) const;
+    // Верхний свёрнутый кластер, в который входит статья, или nullopt, если все её предки раскрыты
+    std::optional<ClusterKey> collapsedAncestor(int nodeId, const std::set<ClusterKey> &expanded) const;
+    // Сквозной номер кластера по всем уровням
+    int flatIndex(ClusterKey key) const { return levelOffsets[key.first] + key.second; }
+
+private:
+    std::unordered_map<int, int> nodeIndex;
+    std::vector<std::vector<int>> nodeCluster; // [уровень][индекс статьи]
+    std::vector<int> clusterCounts;
+    std::vector<int> levelOffsets;
+};
@@ -1,4 +1,7 @@
 #include "graph.h"
+#include "profiler.h"
+#include <algorithm>
+#include <iterator>
 #include <memory>
 #include <jdbc/mysql_driver.h>
 #include <jdbc/mysql_connection.h>
@@ -32,22 +35,103 @@ namespace
         return oss.str();
     }
 }
-Graph::Graph(database::DatabaseManager &dbManager) : db(dbManager) {}
+Graph::Graph(database::DatabaseManager &dbManager) : history(dbManager), db(dbManager) {}
 
 std::vector<NeighborInfo> Graph::getSortedNeighbors(int nodeId)
 {
     std::vector<NeighborInfo> neighbors;
-    for (const auto &[id, name, visitors] : db.getNeighborsSortedByVisitors(nodeId))
+    auto sorted = history.position() ? history.neighborsByVisitors(nodeId) : db.getNeighborsSortedByVisitors(nodeId);
+    for (const auto &[id, name, visitors] : sorted)
     {
         neighbors.push_back({id, name, visitors});
     }
     return neighbors;
 }
 
+std::vector<std::string> Graph::getOutlinks(int nodeId)
+{
+    std::vector<std::string> names;
+    auto position = history.position();
+    auto outlinks = position ? db.getOutlinksAt(nodeId, history.generations()[*position].id) : db.getOutlinks(nodeId);
+    for (const auto &[id, name] : outlinks)
+    {
+        names.push_back(adjust_name(name));
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+void Graph::loadTitleIndex()
+{
+    if (!history.position())
+    {
+        titles.build(db.getAllPages());
+        return;
+    }
+    std::vector<std::tuple<int, std::string, int>> pages;
+    pages.reserve(history.pages().size());
+    for (const auto &[id, page] : history.pages())
+    {
+        pages.emplace_back(id, page.name, page.visitors);
+    }
+    titles.build(std::move(pages));
+}
+
+void Graph::showGeneration(std::optional<std::size_t> index)
+{
+    if (index)
+        history.moveTo(*index);
+    else
+        history.reset();
+    loadTitleIndex();
+}
+
+std::vector<TitleMatch> Graph::searchTitles(std::string_view query, std::size_t limit) const
+{
+    return titles.search(query, limit);
+}
+
+// id в wikipediapages - место статьи в сегодняшнем рейтинге, поэтому после
+// нового цикла парсера найденное название ищется заново, а индекс пересобирается
+std::optional<int> Graph::resolveTitle(TitleMatch const &match)
+{
+    if (history.position())
+        return match.id;
+    auto id = db.getPageIdByName(match.name);
+    if (id != match.id)
+        loadTitleIndex();
+    return id;
+}
+
+void Graph::buildClusters()
+{
+    PROFILE_SCOPE("Clustering");
+    std::vector<int> ids;
+    ids.reserve(nodes.size());
+    for (const auto &[id, node] : nodes)
+    {
+        ids.push_back(id);
+    }
+    std::vector<std::pair<int, int>> links;
+    links.reserve(edges.size());
+    for (const auto &[from, to] : edges)
+    {
+        links.emplace_back(from, to);
+    }
+    clusters.build(ids, links);
+}
+
 void Graph::loadFromDatabase(std::optional<int> startPageId)
 {
     nodes.clear();
     edges.clear();
+    clusters.clear();
+
+    if (history.position())
+    {
+        loadFromSnapshot(startPageId);
+        return;
+    }
 
     int center_id;
     std::string center_name;
@@ -67,12 +151,13 @@ void Graph::loadFromDatabase(std::optional<int> startPageId)
         center_name = name;
     }
 
+    centerId = center_id;
     nodes[center_id] = Node{center_id, adjust_name(center_name), std::nullopt};
 
     std::unordered_set<int> passed{center_id};
     std::vector<int> firstLevel;
 
-    auto neighbors = db.getReferencesSorted(center_id, 10);
+    auto neighbors = db.getReferencesSorted(center_id, firstLevelLimit);
     for (const auto &[id, name] : neighbors)
     {
         nodes[id] = Node{id, adjust_name(name), std::nullopt};
@@ -84,7 +169,7 @@ void Graph::loadFromDatabase(std::optional<int> startPageId)
     for (std::size_t i = 0; i < firstLevel.size(); ++i)
     {
         auto joined = join(passed, ", ");
-        auto secondNeighbors = db.getReferencesExcluding(firstLevel[i], joined, 3);
+        auto secondNeighbors = db.getReferencesExcluding(firstLevel[i], joined, secondLevelLimit);
         for (const auto &[id, name] : secondNeighbors)
         {
             if (passed.insert(id).second)
@@ -94,4 +179,49 @@ void Graph::loadFromDatabase(std::optional<int> startPageId)
             }
         }
     }
+
+    buildClusters();
+}
+
+void Graph::loadFromSnapshot(std::optional<int> startPageId)
+{
+    const auto &pages = history.pages();
+    std::optional<int> center = startPageId && pages.count(*startPageId) ? startPageId : history.mostLinkedPage();
+    if (!center)
+        return;
+
+    centerId = *center;
+    nodes[centerId] = Node{centerId, adjust_name(pages.at(centerId).name), std::nullopt};
+
+    std::unordered_set<int> passed{centerId};
+    std::vector<int> firstLevel;
+
+    auto neighbors = history.neighborsByVisitors(centerId);
+    for (const auto &[id, name, visitors] : neighbors)
+    {
+        if (static_cast<int>(firstLevel.size()) >= firstLevelLimit)
+            break;
+        nodes[id] = Node{id, adjust_name(name), std::nullopt};
+        edges.push_back({centerId, id});
+        passed.insert(id);
+        firstLevel.push_back(id);
+    }
+
+    for (int parent : firstLevel)
+    {
+        int added = 0;
+        for (const auto &[id, name, visitors] : history.neighborsByVisitors(parent))
+        {
+            if (added >= secondLevelLimit)
+                break;
+            if (passed.insert(id).second)
+            {
+                nodes[id] = Node{id, adjust_name(name), std::nullopt};
+                edges.push_back({parent, id});
+                ++added;
+            }
+        }
+    }
+
+    buildClusters();
 }
\ No newline at end of file
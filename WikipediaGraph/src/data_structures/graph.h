@@ -1,6 +1,9 @@
 #pragma once
 
 #include "DatabaseManager.h"
+#include "title_index.h"
+#include "clustering.h"
+#include "history.h"
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -35,9 +38,23 @@ public:
     Graph(Graph const &) = delete;
     std::unordered_map<int, Node> nodes;
     std::vector<Edge> edges;
+    ClusterHierarchy clusters;
+    History history;
+    int centerId = 0;
+    int firstLevelLimit = 10;
+    int secondLevelLimit = 3;
     std::vector<NeighborInfo> getSortedNeighbors(int nodeId);
+    std::vector<std::string> getOutlinks(int nodeId);
     void loadFromDatabase(std::optional<int> startPageId = std::nullopt);
+    void loadTitleIndex();
+    void buildClusters();
+    void showGeneration(std::optional<std::size_t> index);
+    std::vector<TitleMatch> searchTitles(std::string_view query, std::size_t limit) const;
+    std::optional<int> resolveTitle(TitleMatch const &match);
 
 private:
+    void loadFromSnapshot(std::optional<int> startPageId);
+
     database::DatabaseManager &db;
+    TitleIndex titles;
 };
\ No newline at end of file
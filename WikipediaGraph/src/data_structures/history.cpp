@@ -0,0 +1,148 @@
+#include "history.h"
+#include <algorithm>
+
+History::History(database::DatabaseManager &dbManager) : db(dbManager) {}
+
+void History::loadGenerations()
+{
+    list.clear();
+    for (const auto &[id, cycleId, checkpoint] : db.getGenerations())
+    {
+        // cycle_id хранится как YYYYMMDD
+        std::string digits = std::to_string(cycleId);
+        std::string date = digits.size() == 8 ? digits.substr(0, 4) + "-" + digits.substr(4, 2) + "-" + digits.substr(6, 2) : digits;
+        list.push_back({id, date, checkpoint});
+    }
+}
+
+void History::reset()
+{
+    current.reset();
+    state.clear();
+    outgoing.clear();
+}
+
+void History::moveTo(std::size_t index)
+{
+    if (index >= list.size() || current == index)
+        return;
+
+    // Ближайший снимок не позже цели; без снимка состояние собирается с пустого
+    std::optional<std::size_t> checkpoint;
+    for (std::size_t i = index + 1; i-- > 0;)
+    {
+        if (list[i].checkpoint)
+        {
+            checkpoint = i;
+            break;
+        }
+    }
+    std::size_t fromCheckpoint = checkpoint ? index - *checkpoint + 1 : index + 1;
+    std::size_t walk = current ? (*current > index ? *current - index : index - *current) : fromCheckpoint + 1;
+
+    if (fromCheckpoint < walk)
+    {
+        state.clear();
+        outgoing.clear();
+        std::size_t next = 0;
+        if (checkpoint)
+        {
+            loadCheckpoint(*checkpoint);
+            next = *checkpoint + 1;
+        }
+        for (std::size_t i = next; i <= index; ++i)
+        {
+            apply(delta(i), true);
+        }
+    }
+    else if (*current < index)
+    {
+        for (std::size_t i = *current + 1; i <= index; ++i)
+        {
+            apply(delta(i), true);
+        }
+    }
+    else
+    {
+        for (std::size_t i = *current; i > index; --i)
+        {
+            apply(delta(i), false);
+        }
+    }
+    current = index;
+}
+
+std::vector<std::tuple<int, std::string, int>> History::neighborsByVisitors(int pageId) const
+{
+    std::vector<std::tuple<int, std::string, int>> neighbors;
+    auto it = outgoing.find(pageId);
+    if (it == outgoing.end())
+        return neighbors;
+    for (int id : it->second)
+    {
+        auto page = state.find(id);
+        if (page != state.end())
+            neighbors.emplace_back(id, page->second.name, page->second.visitors);
+    }
+    std::sort(neighbors.begin(), neighbors.end(), [](const auto &a, const auto &b)
+              { return std::get<2>(a) > std::get<2>(b); });
+    return neighbors;
+}
+
+std::optional<int> History::mostLinkedPage() const
+{
+    std::optional<int> best;
+    std::size_t bestCount = 0;
+    for (const auto &[id, targets] : outgoing)
+    {
+        if (state.count(id) && (!best || targets.size() > bestCount))
+        {
+            best = id;
+            bestCount = targets.size();
+        }
+    }
+    return best;
+}
+
+const History::Delta &History::delta(std::size_t index)
+{
+    int id = list[index].id;
+    auto it = deltas.find(id);
+    if (it == deltas.end())
+    {
+        it = deltas.emplace(id, Delta{db.getGenerationPages(id), db.getGenerationEdges(id)}).first;
+    }
+    return it->second;
+}
+
+void History::apply(const Delta &delta, bool forward)
+{
+    for (const auto &[id, name, before, after] : delta.pages)
+    {
+        const auto &value = forward ? after : before;
+        if (value)
+            state[id] = SnapshotPage{name, *value};
+        else
+            state.erase(id);
+    }
+    for (const auto &[from, to, added] : delta.edges)
+    {
+        if (added == forward)
+            outgoing[from].insert(to);
+        else
+            outgoing[from].erase(to);
+    }
+}
+
+void History::loadCheckpoint(std::size_t index)
+{
+    int id = list[index].id;
+    for (const auto &[pageId, name, visitors] : db.getCheckpointPages(id))
+    {
+        state[pageId] = SnapshotPage{name, visitors};
+    }
+    for (const auto &[from, to] : db.getCheckpointEdges(id))
+    {
+        outgoing[from].insert(to);
+    }
+}
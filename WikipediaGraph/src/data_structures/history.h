@@ -0,0 +1,59 @@
+#pragma once
+
+#include "DatabaseManager.h"
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct GenerationInfo
+{
+    int id;
+    std::string date;
+    bool checkpoint;
+};
+
+struct SnapshotPage
+{
+    std::string name;
+    int visitors;
+};
+
+// Граф на выбранную дату, восстановленный из дельт парсера. Загруженные дельты
+// кешируются, поэтому переход между соседними датами применяет одну дельту
+// в нужную сторону, а дальние переходы начинаются с ближайшего полного снимка.
+class History
+{
+public:
+    explicit History(database::DatabaseManager &dbManager);
+
+    void loadGenerations();
+    const std::vector<GenerationInfo> &generations() const { return list; }
+    std::optional<std::size_t> position() const { return current; }
+    void moveTo(std::size_t index);
+    void reset();
+
+    const std::unordered_map<int, SnapshotPage> &pages() const { return state; }
+    std::vector<std::tuple<int, std::string, int>> neighborsByVisitors(int pageId) const;
+    std::optional<int> mostLinkedPage() const;
+
+private:
+    struct Delta
+    {
+        std::vector<std::tuple<int, std::string, std::optional<int>, std::optional<int>>> pages;
+        std::vector<std::tuple<int, int, bool>> edges;
+    };
+
+    const Delta &delta(std::size_t index);
+    void apply(const Delta &delta, bool forward);
+    void loadCheckpoint(std::size_t index);
+
+    database::DatabaseManager &db;
+    std::vector<GenerationInfo> list;
+    std::unordered_map<int, Delta> deltas;
+    std::optional<std::size_t> current;
+    std::unordered_map<int, SnapshotPage> state;
+    std::unordered_map<int, std::unordered_set<int>> outgoing;
+};
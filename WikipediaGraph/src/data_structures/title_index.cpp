@@ -0,0 +1,241 @@
+#include "title_index.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <queue>
+
+namespace
+{
+    // Нечёткий поиск сливает списки триграмм блоками рангов и просматривает не
+    // больше fuzzyPostingBudget позиций, чтобы запрос из частых триграмм не
+    // обходил миллионы записей
+    constexpr std::uint32_t fuzzyBlock = 4096;
+    constexpr std::size_t fuzzyPostingBudget = 1 << 17;
+
+    std::string normalize(std::string_view name)
+    {
+        std::string key;
+        key.reserve(name.size());
+        for (unsigned char ch : name)
+        {
+            key.push_back(ch == '_' ? ' ' : static_cast<char>(std::tolower(ch)));
+        }
+        return key;
+    }
+
+    std::vector<std::uint32_t> extract_trigrams(std::string const &key)
+    {
+        std::string padded = " " + key + " ";
+        std::vector<std::uint32_t> grams;
+        for (std::size_t i = 0; i + 3 <= padded.size(); ++i)
+        {
+            grams.push_back(static_cast<std::uint32_t>(static_cast<unsigned char>(padded[i])) << 16 |
+                            static_cast<std::uint32_t>(static_cast<unsigned char>(padded[i + 1])) << 8 |
+                            static_cast<std::uint32_t>(static_cast<unsigned char>(padded[i + 2])));
+        }
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        return grams;
+    }
+}
+
+void TitleIndex::build(std::vector<std::tuple<int, std::string, int>> pages)
+{
+    entries.clear();
+    maxTree.clear();
+    byRank.clear();
+    trigrams.clear();
+
+    entries.reserve(pages.size());
+    for (auto &[id, name, visitors] : pages)
+    {
+        entries.push_back({normalize(name), id, std::move(name), visitors});
+    }
+    std::sort(entries.begin(), entries.end(), [](Entry const &a, Entry const &b)
+              { return a.key < b.key; });
+
+    std::size_t n = entries.size();
+    maxTree.resize(2 * n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        maxTree[n + i] = static_cast<std::uint32_t>(i);
+    }
+    for (std::size_t i = n; i-- > 1;)
+    {
+        maxTree[i] = better(maxTree[2 * i], maxTree[2 * i + 1]);
+    }
+
+    byRank.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        byRank[i] = static_cast<std::uint32_t>(i);
+    }
+    std::sort(byRank.begin(), byRank.end(), [this](std::uint32_t a, std::uint32_t b)
+              { return a != b && better(a, b) == a; });
+
+    // Ранги добавляются по возрастанию, поэтому списки уже отсортированы
+    for (std::size_t rank = 0; rank < n; ++rank)
+    {
+        for (auto gram : extract_trigrams(entries[byRank[rank]].key))
+        {
+            trigrams[gram].push_back(static_cast<std::uint32_t>(rank));
+        }
+    }
+}
+
+std::vector<TitleMatch> TitleIndex::search(std::string_view query, std::size_t limit) const
+{
+    std::string key = normalize(query);
+    if (key.empty() || limit == 0 || entries.empty())
+        return {};
+
+    auto first = std::lower_bound(entries.begin(), entries.end(), key, [](Entry const &e, std::string const &k)
+                                  { return e.key < k; });
+    auto last = std::partition_point(first, entries.end(), [&key](Entry const &e)
+                                     { return e.key.starts_with(key); });
+    std::size_t from = first - entries.begin();
+    std::size_t to = last - entries.begin();
+
+    std::vector<std::uint32_t> found;
+    prefixTopK(from, to, limit, found);
+    if (found.size() < limit && key.size() >= 3)
+    {
+        fuzzyTopK(key, from, to, limit - found.size(), found);
+    }
+
+    std::vector<TitleMatch> result;
+    result.reserve(found.size());
+    for (auto idx : found)
+    {
+        result.push_back({entries[idx].id, entries[idx].name, entries[idx].visitors});
+    }
+    return result;
+}
+
+std::uint32_t TitleIndex::better(std::uint32_t a, std::uint32_t b) const
+{
+    if (entries[a].visitors != entries[b].visitors)
+        return entries[a].visitors > entries[b].visitors ? a : b;
+    return std::min(a, b);
+}
+
+std::uint32_t TitleIndex::argmax(std::size_t from, std::size_t to) const
+{
+    std::size_t n = entries.size();
+    std::uint32_t best = static_cast<std::uint32_t>(from);
+    for (from += n, to += n; from < to; from >>= 1, to >>= 1)
+    {
+        if (from & 1)
+            best = better(best, maxTree[from++]);
+        if (to & 1)
+            best = better(best, maxTree[--to]);
+    }
+    return best;
+}
+
+void TitleIndex::prefixTopK(std::size_t from, std::size_t to, std::size_t limit, std::vector<std::uint32_t> &out) const
+{
+    // Отрезок [from, to) делится по своему максимуму: K лучших за O(K log n)
+    struct Range
+    {
+        std::uint32_t best;
+        std::size_t from;
+        std::size_t to;
+    };
+    auto cmp = [this](Range const &a, Range const &b)
+    { return better(a.best, b.best) == b.best; };
+    std::priority_queue<Range, std::vector<Range>, decltype(cmp)> heap(cmp);
+
+    if (from < to)
+        heap.push({argmax(from, to), from, to});
+
+    while (!heap.empty() && out.size() < limit)
+    {
+        Range range = heap.top();
+        heap.pop();
+        out.push_back(range.best);
+        if (range.from < range.best)
+            heap.push({argmax(range.from, range.best), range.from, range.best});
+        if (range.best + 1 < range.to)
+            heap.push({argmax(range.best + 1, range.to), range.best + 1, range.to});
+    }
+}
+
+void TitleIndex::fuzzyTopK(std::string const &key, std::size_t skipFrom, std::size_t skipTo, std::size_t limit, std::vector<std::uint32_t> &out) const
+{
+    auto grams = extract_trigrams(key);
+    std::size_t need = std::max<std::size_t>(1, (grams.size() + 1) / 2);
+
+    struct Cursor
+    {
+        std::uint32_t const *pos;
+        std::uint32_t const *end;
+    };
+    std::vector<Cursor> cursors;
+    for (auto gram : grams)
+    {
+        auto it = trigrams.find(gram);
+        if (it != trigrams.end())
+            cursors.push_back({it->second.data(), it->second.data() + it->second.size()});
+    }
+
+    // Кандидаты приходят по возрастанию ранга, т.е. от популярных статей к менее
+    // популярным. best упорядочен по (совпадений больше, ранг меньше)
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> best;
+    auto ahead = [](std::pair<std::uint32_t, std::uint32_t> const &a, std::pair<std::uint32_t, std::uint32_t> const &b)
+    { return a.first != b.first ? a.first > b.first : a.second < b.second; };
+
+    std::array<std::uint16_t, fuzzyBlock> counts{};
+    std::vector<std::uint32_t> touched;
+    std::size_t consumed = 0;
+    while (consumed < fuzzyPostingBudget)
+    {
+        std::uint32_t from = UINT32_MAX;
+        std::size_t alive = 0;
+        for (auto const &cursor : cursors)
+        {
+            if (cursor.pos != cursor.end)
+            {
+                from = std::min(from, *cursor.pos);
+                ++alive;
+            }
+        }
+        // Дальше у записи не больше alive совпадений и ранг хуже, чем у отобранных
+        if (alive < need || (best.size() == limit && best.back().first >= alive))
+            break;
+
+        std::uint32_t to = from + fuzzyBlock;
+        for (auto &cursor : cursors)
+        {
+            auto begin = cursor.pos;
+            for (; cursor.pos != cursor.end && *cursor.pos < to; ++cursor.pos)
+            {
+                if (counts[*cursor.pos - from]++ == 0)
+                    touched.push_back(*cursor.pos);
+            }
+            consumed += cursor.pos - begin;
+        }
+
+        for (auto rank : touched)
+        {
+            std::pair<std::uint32_t, std::uint32_t> candidate{counts[rank - from], rank};
+            counts[rank - from] = 0;
+            if (candidate.first < need)
+                continue;
+            if (best.size() == limit && !ahead(candidate, best.back()))
+                continue;
+            auto idx = byRank[rank];
+            if (idx >= skipFrom && idx < skipTo)
+                continue;
+            best.insert(std::upper_bound(best.begin(), best.end(), candidate, ahead), candidate);
+            if (best.size() > limit)
+                best.pop_back();
+        }
+        touched.clear();
+    }
+
+    for (auto const &[hits, rank] : best)
+    {
+        out.push_back(byRank[rank]);
+    }
+}
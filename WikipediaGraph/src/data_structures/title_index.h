@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+struct TitleMatch
+{
+    int id;
+    std::string name;
+    int visitors;
+};
+
+// Индекс названий статей: отсортированный массив ключей для поиска по префиксу
+// и триграммный индекс для нечёткого поиска. Результаты ранжируются по visitors.
+class TitleIndex
+{
+public:
+    void build(std::vector<std::tuple<int, std::string, int>> pages);
+    std::vector<TitleMatch> search(std::string_view query, std::size_t limit) const;
+
+    bool empty() const { return entries.empty(); }
+    std::size_t size() const { return entries.size(); }
+
+private:
+    struct Entry
+    {
+        std::string key;
+        int id;
+        std::string name;
+        int visitors;
+    };
+
+    std::vector<Entry> entries;
+    // Дерево отрезков над entries: индекс записи с максимальным visitors
+    std::vector<std::uint32_t> maxTree;
+    // Записи по убыванию visitors; списки триграмм хранят ранги из этого порядка
+    std::vector<std::uint32_t> byRank;
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigrams;
+
+    std::uint32_t better(std::uint32_t a, std::uint32_t b) const;
+    std::uint32_t argmax(std::size_t from, std::size_t to) const;
+    void prefixTopK(std::size_t from, std::size_t to, std::size_t limit, std::vector<std::uint32_t> &out) const;
+    void fuzzyTopK(std::string const &key, std::size_t skipFrom, std::size_t skipTo, std::size_t limit, std::vector<std::uint32_t> &out) const;
+};
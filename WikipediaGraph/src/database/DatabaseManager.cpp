@@ -1,9 +1,21 @@
 // DatabaseManager.cpp
 #include <string>
+#include <iterator>
 #include "DatabaseManager.h"
+#include "parser/adjacency.h"
+#include "profiler.h"
 
 namespace database
 {
+    namespace
+    {
+        std::string readBlob(sql::ResultSet &res, int column)
+        {
+            std::unique_ptr<std::istream> blob(res.getBlob(column));
+            return {std::istreambuf_iterator<char>(*blob), std::istreambuf_iterator<char>()};
+        }
+    }
+
     DatabaseManager::DatabaseManager(const std::string &src_host, const std::string &src_user, const std::string &src_password, const std::string &src_schema)
     {
         sql::mysql::MySQL_Driver *driver = sql::mysql::get_mysql_driver_instance();
@@ -13,12 +25,11 @@ namespace database
 
     std::vector<std::tuple<int, std::string, int>> DatabaseManager::getNeighborsSortedByVisitors(int nodeId)
     {
+        PROFILE_SCOPE("SQL");
         std::vector<std::tuple<int, std::string, int>> neighbors;
         auto stmt = conn->prepareStatement(
-            "SELECT wp.id, wp.name, wp.visitors_last_5_days "
-            "FROM pagereferences pr "
-            "JOIN wikipediapages wp ON pr.referenced_page_id = wp.id "
-            "WHERE pr.page_id = ? ORDER BY wp.visitors_last_5_days DESC");
+            "SELECT neighbor_id AS id, name, visitors AS visitors_last_5_days "
+            "FROM pageneighbors WHERE page_id = ? ORDER BY neighbor_rank");
         stmt->setInt(1, nodeId);
         auto res = stmt->executeQuery();
         while (res->next())
@@ -30,6 +41,7 @@ namespace database
 
     std::optional<std::pair<int, std::string>> DatabaseManager::getPageById(int id)
     {
+        PROFILE_SCOPE("SQL");
         auto stmt = conn->prepareStatement("SELECT id, name FROM wikipediapages WHERE id = ?");
         stmt->setInt(1, id);
         auto res = stmt->executeQuery();
@@ -40,8 +52,22 @@ namespace database
         return std::nullopt;
     }
 
+    std::optional<int> DatabaseManager::getPageIdByName(const std::string &name)
+    {
+        PROFILE_SCOPE("SQL");
+        auto stmt = conn->prepareStatement("SELECT id FROM wikipediapages WHERE name = ?");
+        stmt->setString(1, name);
+        auto res = stmt->executeQuery();
+        if (res->next())
+        {
+            return res->getInt(1);
+        }
+        return std::nullopt;
+    }
+
     std::pair<int, std::string> DatabaseManager::getMostReferencedPage()
     {
+        PROFILE_SCOPE("SQL");
         auto stmt = conn->prepareStatement(
             "SELECT id, name FROM wikipediapages WHERE id = ("
             "SELECT page_id FROM (SELECT page_id, COUNT(*) cnt FROM pagereferences "
@@ -53,11 +79,11 @@ namespace database
 
     std::vector<std::pair<int, std::string>> DatabaseManager::getReferencesSorted(int fromId, int limit)
     {
+        PROFILE_SCOPE("SQL");
         std::vector<std::pair<int, std::string>> refs;
         auto stmt = conn->prepareStatement(
-            "SELECT p.referenced_page_id, w.name FROM pagereferences p "
-            "JOIN wikipediapages w ON p.referenced_page_id = w.id "
-            "WHERE p.page_id = ? ORDER BY w.visitors_last_5_days DESC LIMIT ?");
+            "SELECT neighbor_id, name FROM pageneighbors "
+            "WHERE page_id = ? ORDER BY neighbor_rank LIMIT ?");
         stmt->setInt(1, fromId);
         stmt->setInt(2, limit);
         auto res = stmt->executeQuery();
@@ -70,13 +96,13 @@ namespace database
 
     std::vector<std::pair<int, std::string>> DatabaseManager::getReferencesExcluding(int fromId, const std::string &excludedIdsCSV, int limit)
     {
+        PROFILE_SCOPE("SQL");
         std::vector<std::pair<int, std::string>> refs;
         std::string query =
-            "SELECT p.referenced_page_id, w.name FROM pagereferences p "
-            "JOIN wikipediapages w ON p.referenced_page_id = w.id "
-            "WHERE p.page_id = ? AND p.referenced_page_id NOT IN (" +
+            "SELECT neighbor_id, name FROM pageneighbors "
+            "WHERE page_id = ? AND neighbor_id NOT IN (" +
             excludedIdsCSV + ") "
-                             "ORDER BY w.visitors_last_5_days DESC LIMIT ?";
+                             "ORDER BY neighbor_rank LIMIT ?";
         auto stmt = conn->prepareStatement(query);
         stmt->setInt(1, fromId);
         stmt->setInt(2, limit);
@@ -87,4 +113,147 @@ namespace database
         }
         return refs;
     }
+
+    std::vector<std::tuple<int, std::string, int>> DatabaseManager::getAllPages()
+    {
+        PROFILE_SCOPE("SQL");
+        std::vector<std::tuple<int, std::string, int>> pages;
+        auto stmt = conn->prepareStatement("SELECT id, name, visitors_last_5_days FROM wikipediapages");
+        auto res = stmt->executeQuery();
+        while (res->next())
+        {
+            pages.emplace_back(res->getInt(1), res->getString(2), res->getInt(3));
+        }
+        return pages;
+    }
+
+    std::vector<std::pair<int, std::string>> DatabaseManager::getOutlinks(int pageId)
+    {
+        PROFILE_SCOPE("SQL");
+        auto stmt = conn->prepareStatement("SELECT links FROM pageoutlinks WHERE page_id = ?");
+        stmt->setInt(1, pageId);
+        auto res = stmt->executeQuery();
+        if (!res->next())
+            return {};
+        return getLinkTargets(adjacency::decode(readBlob(*res, 1)));
+    }
+
+    std::vector<std::pair<int, std::string>> DatabaseManager::getOutlinksAt(int titleId, int generationId)
+    {
+        PROFILE_SCOPE("SQL");
+        // Дельта хранит весь список статьи, поэтому достаточно последней записи до выбранной даты
+        auto stmt = conn->prepareStatement(
+            "SELECT links FROM generationoutlinks WHERE title_id = ? AND generation_id <= ? "
+            "ORDER BY generation_id DESC LIMIT 1");
+        stmt->setInt(1, titleId);
+        stmt->setInt(2, generationId);
+        auto res = stmt->executeQuery();
+        if (!res->next() || res->isNull(1))
+            return {};
+        return getLinkTargets(adjacency::decode(readBlob(*res, 1)));
+    }
+
+    std::vector<std::pair<int, std::string>> DatabaseManager::getLinkTargets(const std::vector<int> &ids)
+    {
+        constexpr std::size_t chunk = 500;
+        std::vector<std::pair<int, std::string>> targets;
+        targets.reserve(ids.size());
+        for (std::size_t begin = 0; begin < ids.size(); begin += chunk)
+        {
+            std::size_t count = std::min(chunk, ids.size() - begin);
+            std::string query = "SELECT id, name FROM linktargets WHERE id IN (";
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                query += i ? ", ?" : "?";
+            }
+            auto stmt = conn->prepareStatement(query + ")");
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                stmt->setInt(static_cast<int>(i + 1), ids[begin + i]);
+            }
+            auto res = stmt->executeQuery();
+            while (res->next())
+            {
+                targets.emplace_back(res->getInt(1), res->getString(2));
+            }
+        }
+        return targets;
+    }
+
+    std::vector<std::tuple<int, int, bool>> DatabaseManager::getGenerations()
+    {
+        PROFILE_SCOPE("SQL");
+        std::vector<std::tuple<int, int, bool>> generations;
+        auto stmt = conn->prepareStatement("SELECT id, cycle_id, is_checkpoint FROM generations ORDER BY id");
+        auto res = stmt->executeQuery();
+        while (res->next())
+        {
+            generations.emplace_back(res->getInt(1), res->getInt(2), res->getInt(3) != 0);
+        }
+        return generations;
+    }
+
+    std::vector<std::tuple<int, std::string, std::optional<int>, std::optional<int>>> DatabaseManager::getGenerationPages(int generationId)
+    {
+        PROFILE_SCOPE("SQL");
+        std::vector<std::tuple<int, std::string, std::optional<int>, std::optional<int>>> pages;
+        auto stmt = conn->prepareStatement(
+            "SELECT g.title_id, t.name, g.visitors_before, g.visitors_after FROM generationpages g "
+            "JOIN linktargets t ON g.title_id = t.id WHERE g.generation_id = ?");
+        stmt->setInt(1, generationId);
+        auto res = stmt->executeQuery();
+        while (res->next())
+        {
+            std::optional<int> before = res->isNull(3) ? std::nullopt : std::optional<int>(res->getInt(3));
+            std::optional<int> after = res->isNull(4) ? std::nullopt : std::optional<int>(res->getInt(4));
+            pages.emplace_back(res->getInt(1), res->getString(2), before, after);
+        }
+        return pages;
+    }
+
+    std::vector<std::tuple<int, int, bool>> DatabaseManager::getGenerationEdges(int generationId)
+    {
+        PROFILE_SCOPE("SQL");
+        std::vector<std::tuple<int, int, bool>> edges;
+        auto stmt = conn->prepareStatement(
+            "SELECT title_id, referenced_title_id, added FROM generationedges WHERE generation_id = ?");
+        stmt->setInt(1, generationId);
+        auto res = stmt->executeQuery();
+        while (res->next())
+        {
+            edges.emplace_back(res->getInt(1), res->getInt(2), res->getInt(3) != 0);
+        }
+        return edges;
+    }
+
+    std::vector<std::tuple<int, std::string, int>> DatabaseManager::getCheckpointPages(int generationId)
+    {
+        PROFILE_SCOPE("SQL");
+        std::vector<std::tuple<int, std::string, int>> pages;
+        auto stmt = conn->prepareStatement(
+            "SELECT c.title_id, t.name, c.visitors FROM checkpointpages c "
+            "JOIN linktargets t ON c.title_id = t.id WHERE c.generation_id = ?");
+        stmt->setInt(1, generationId);
+        auto res = stmt->executeQuery();
+        while (res->next())
+        {
+            pages.emplace_back(res->getInt(1), res->getString(2), res->getInt(3));
+        }
+        return pages;
+    }
+
+    std::vector<std::pair<int, int>> DatabaseManager::getCheckpointEdges(int generationId)
+    {
+        PROFILE_SCOPE("SQL");
+        std::vector<std::pair<int, int>> edges;
+        auto stmt = conn->prepareStatement(
+            "SELECT title_id, referenced_title_id FROM checkpointedges WHERE generation_id = ?");
+        stmt->setInt(1, generationId);
+        auto res = stmt->executeQuery();
+        while (res->next())
+        {
+            edges.emplace_back(res->getInt(1), res->getInt(2));
+        }
+        return edges;
+    }
 }
\ No newline at end of file
@@ -21,13 +21,28 @@ namespace database
     public:
         DatabaseManager(const std::string &src_host, const std::string &src_user, const std::string &src_password, const std::string &src_schema);
 
+        // Соседи читаются из pageneighbors, которую парсер заполняет уже отсортированной
         std::vector<std::tuple<int, std::string, int>> getNeighborsSortedByVisitors(int nodeId);
         std::optional<std::pair<int, std::string>> getPageById(int id);
+        std::optional<int> getPageIdByName(const std::string &name);
         std::pair<int, std::string> getMostReferencedPage();
         std::vector<std::pair<int, std::string>> getReferencesSorted(int fromId, int limit);
         std::vector<std::pair<int, std::string>> getReferencesExcluding(int fromId, const std::string &excludedIdsCSV, int limit);
+        std::vector<std::tuple<int, std::string, int>> getAllPages();
+        // Все исходящие ссылки статьи из pageoutlinks: (id в linktargets, название)
+        std::vector<std::pair<int, std::string>> getOutlinks(int pageId);
+
+        // История по дням (таблицы generations, generationpages, generationedges, checkpoint*)
+        std::vector<std::tuple<int, int, bool>> getGenerations();
+        std::vector<std::tuple<int, std::string, std::optional<int>, std::optional<int>>> getGenerationPages(int generationId);
+        std::vector<std::tuple<int, int, bool>> getGenerationEdges(int generationId);
+        std::vector<std::tuple<int, std::string, int>> getCheckpointPages(int generationId);
+        std::vector<std::pair<int, int>> getCheckpointEdges(int generationId);
+        std::vector<std::pair<int, std::string>> getOutlinksAt(int titleId, int generationId);
 
     private:
+        std::vector<std::pair<int, std::string>> getLinkTargets(const std::vector<int> &ids);
+
         std::unique_ptr<sql::Connection> conn;
     };
 
@@ -8,6 +8,7 @@
 
 #include "graph.h"
 #include "render.h"
+#include "profiler.h"
 
 constexpr auto start = 1;
 
@@ -67,6 +68,7 @@ int main()
     try
     {
         graph.loadFromDatabase();
+        graph.loadTitleIndex();
     }
     catch (std::exception const &exc)
     {
@@ -76,10 +78,20 @@ int main()
     }
     std::cout << "Graph created" << std::endl;
 
+    try
+    {
+        graph.history.loadGenerations();
+    }
+    catch (std::exception const &exc)
+    {
+        std::cerr << "History is unavailable: " << exc.what() << std::endl;
+    }
+
     randomizeNodePositions(graph,  dbManager.getMostReferencedPage().first);
 
     while (!glfwWindowShouldClose(window))
     {
+        profiling::beginFrame();
         glfwPollEvents();
 
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -89,11 +101,13 @@ int main()
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
         renderGraph(graph);
+        profiling::renderOverlay();
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(window);
 
         checkGLErrors();
+        profiling::endFrame();
     }
 
 
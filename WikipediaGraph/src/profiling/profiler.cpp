@@ -0,0 +1,196 @@
+#include "profiler.h"
+#include <imgui.h>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace profiling
+{
+    namespace
+    {
+        constexpr int historySize = 240;
+
+        struct PhaseStats
+        {
+            const char *phase;
+            float accumulated = 0.0f;
+            std::array<float, historySize> history{};
+        };
+
+        struct TraceEvent
+        {
+            const char *phase;
+            const char *label;
+            long long startUs;
+            long long durationUs;
+            int thread;
+        };
+
+        std::mutex mutex;
+        std::vector<PhaseStats> phases;
+        std::array<float, historySize> frameHistory{};
+        int historyOffset = 0;
+        bool frameStarted = false;
+        Clock::time_point frameBegin;
+        Clock::time_point const origin = Clock::now();
+
+        bool capturing = false;
+        Clock::time_point captureEnd;
+        std::string capturePath;
+        std::string lastTrace;
+        std::vector<TraceEvent> events;
+        std::unordered_map<std::thread::id, int> threadIds;
+
+        PhaseStats &statsFor(const char *phase)
+        {
+            for (auto &stats : phases)
+            {
+                if (stats.phase == phase || std::strcmp(stats.phase, phase) == 0)
+                    return stats;
+            }
+            return phases.emplace_back(PhaseStats{phase});
+        }
+
+        long long micros(Clock::time_point time)
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(time - origin).count();
+        }
+
+        void addEvent(const char *phase, const char *label, Clock::time_point begin, Clock::time_point end)
+        {
+            auto [it, inserted] = threadIds.try_emplace(std::this_thread::get_id(), static_cast<int>(threadIds.size()) + 1);
+            events.push_back({phase, label, micros(begin), micros(end) - micros(begin), it->second});
+        }
+
+        void writeTrace()
+        {
+            std::ofstream out(capturePath);
+            if (!out)
+            {
+                std::cerr << "Cannot write trace: " << capturePath << std::endl;
+                return;
+            }
+            // Формат Chrome trace event: открывается в chrome://tracing и Perfetto
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+            for (std::size_t i = 0; i < events.size(); ++i)
+            {
+                auto const &event = events[i];
+                out << (i ? ",\n" : "\n")
+                    << "{\"name\":\"" << (event.label ? event.label : event.phase)
+                    << "\",\"cat\":\"" << event.phase
+                    << "\",\"ph\":\"X\",\"ts\":" << event.startUs
+                    << ",\"dur\":" << event.durationUs
+                    << ",\"pid\":1,\"tid\":" << event.thread << "}";
+            }
+            out << "\n]}\n";
+            lastTrace = capturePath;
+            events.clear();
+        }
+
+        void startCaptureLocked(float seconds, std::string path)
+        {
+            events.clear();
+            capturePath = std::move(path);
+            captureEnd = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(seconds));
+            capturing = true;
+        }
+    }
+
+    void record(const char *phase, const char *label, Clock::time_point begin, Clock::time_point end)
+    {
+        std::lock_guard lock(mutex);
+        statsFor(phase).accumulated += std::chrono::duration<float, std::milli>(end - begin).count();
+        if (capturing)
+            addEvent(phase, label, begin, end);
+    }
+
+    void beginFrame()
+    {
+        frameStarted = enabled;
+        if (frameStarted)
+            frameBegin = Clock::now();
+    }
+
+    void endFrame()
+    {
+        if (!frameStarted || !enabled)
+            return;
+        auto frameEnd = Clock::now();
+
+        std::lock_guard lock(mutex);
+        frameHistory[historyOffset] = std::chrono::duration<float, std::milli>(frameEnd - frameBegin).count();
+        for (auto &stats : phases)
+        {
+            stats.history[historyOffset] = stats.accumulated;
+            stats.accumulated = 0.0f;
+        }
+        historyOffset = (historyOffset + 1) % historySize;
+
+        if (capturing)
+        {
+            addEvent("Frame", "Frame", frameBegin, frameEnd);
+            if (frameEnd >= captureEnd)
+            {
+                capturing = false;
+                writeTrace();
+            }
+        }
+    }
+
+    void renderOverlay()
+    {
+        std::lock_guard lock(mutex);
+        if (ImGui::IsKeyPressed(ImGuiKey_F3, false))
+        {
+            enabled = !enabled;
+            // Запись, прерванная закрытием оверлея, сохраняется сразу, иначе трасса
+            // захватила бы время до следующего открытия
+            if (!enabled && capturing)
+            {
+                capturing = false;
+                writeTrace();
+            }
+        }
+        if (!enabled)
+            return;
+
+        ImGui::Begin("Profiler (F3)", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+        char overlay[64];
+        int last = (historyOffset + historySize - 1) % historySize;
+        std::snprintf(overlay, sizeof(overlay), "%.2f ms", frameHistory[last]);
+        ImGui::PlotLines("Frame", frameHistory.data(), historySize, historyOffset, overlay, 0.0f, 50.0f, ImVec2(320, 60));
+        for (auto const &stats : phases)
+        {
+            std::snprintf(overlay, sizeof(overlay), "%.3f ms", stats.history[last]);
+            ImGui::PlotLines(stats.phase, stats.history.data(), historySize, historyOffset, overlay, 0.0f, FLT_MAX, ImVec2(320, 40));
+        }
+
+        ImGui::Separator();
+        static int seconds = 5;
+        ImGui::InputInt("Seconds", &seconds);
+        seconds = std::max(1, std::min(seconds, 120));
+        if (capturing)
+        {
+            ImGui::Text("Recording... %.1f s left", std::chrono::duration<float>(captureEnd - Clock::now()).count());
+        }
+        else if (ImGui::Button("Record trace"))
+        {
+            startCaptureLocked(static_cast<float>(seconds), "trace_" + std::to_string(std::time(nullptr)) + ".json");
+        }
+        if (!lastTrace.empty())
+        {
+            ImGui::Text("Saved %s", lastTrace.c_str());
+        }
+        ImGui::End();
+    }
+}
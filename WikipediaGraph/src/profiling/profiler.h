@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// Таймеры горячих участков: SQL, раскладка графа, отрисовка imnodes.
+// Пока профайлер выключен, PROFILE_SCOPE стоит одну проверку флага.
+namespace profiling
+{
+    using Clock = std::chrono::steady_clock;
+
+    inline bool enabled = false;
+
+    void record(const char *phase, const char *label, Clock::time_point begin, Clock::time_point end);
+    void beginFrame();
+    void endFrame();
+    void renderOverlay();
+
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(const char *phase, const char *label) : phase(enabled ? phase : nullptr), label(label)
+        {
+            if (this->phase)
+                begin = Clock::now();
+        }
+
+        ~ScopedTimer()
+        {
+            if (phase)
+                record(phase, label, begin, Clock::now());
+        }
+
+        ScopedTimer(ScopedTimer const &) = delete;
+        ScopedTimer &operator=(ScopedTimer const &) = delete;
+
+    private:
+        const char *phase;
+        const char *label;
+        Clock::time_point begin;
+    };
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef WIKIPEDIAGRAPH_NO_PROFILER
+#define PROFILE_SCOPE(phase)
+#else
+#define PROFILE_SCOPE(phase) profiling::ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(phase, __func__)
+#endif
@@ -1,21 +1,56 @@
 #include "render.h"
+#include "profiler.h"
+#include <algorithm>
 #include <imgui.h>
 #include <imnodes.h>
 #include <chrono>
+#include <cmath>
 #include <iostream>
+#include <map>
+#include <optional>
+#include <set>
 #include <unordered_set>
 #include <random>
 #include <thread>
 
 static int currentNodeId = 0;
+static int centerNodeId = 0;
 static std::unordered_map<int, ImVec2> nodePositions;
 
+// Выше этого числа статей граф рисуется свёрнутыми кластерами
+constexpr std::size_t clusterViewThreshold = 200;
+
+struct ClusterNode
+{
+    int id; // отрицательный, чтобы не пересекаться с id статей
+    ClusterHierarchy::ClusterKey key;
+    int size;
+    std::string label;
+    ImVec2 position;
+};
+
+struct ClusterLink
+{
+    int from;
+    int to;
+    int weight;
+};
+
+static bool clusterViewEnabled = true;
+static bool clusterViewDirty = true;
+static std::set<ClusterHierarchy::ClusterKey> expandedClusters;
+static std::vector<int> visiblePages;
+static std::vector<ClusterNode> visibleClusters;
+static std::vector<ClusterLink> visibleLinks;
+
 void randomizeNodePositions(Graph &graph, int centerId)
 {
+    PROFILE_SCOPE("Layout");
     const float R1 = 220.0f;
     const float R2 = 440.0f;
     const ImVec2 center = ImVec2(750.0f, 450.0f);
 
+    centerNodeId = centerId;
     nodePositions.clear();
     nodePositions[centerId] = center;
     graph.nodes[centerId].position = center;
@@ -67,30 +102,196 @@ void loadSubGraph(Graph &graph, int nodeId)
     graph.edges.clear();
     graph.loadFromDatabase(nodeId);
 
-    randomizeNodePositions(graph, nodeId);
+    if (!graph.nodes.empty())
+    {
+        currentNodeId = graph.centerId;
+        randomizeNodePositions(graph, graph.centerId);
+    }
+    expandedClusters.clear();
+    clusterViewDirty = true;
 }
 
-void renderGraph(Graph &graph)
+static bool clusterViewActive(Graph const &graph)
 {
-    if (graph.nodes.empty())
+    return clusterViewEnabled && graph.nodes.size() > clusterViewThreshold && graph.clusters.levels() > 0;
+}
+
+// В режиме кластеров проверяются только статьи на экране, а не весь граф
+static std::optional<int> selectedPage(Graph const &graph)
+{
+    if (clusterViewActive(graph))
     {
-        loadSubGraph(graph, currentNodeId);
+        for (int id : visiblePages)
+        {
+            if (ImNodes::IsNodeSelected(id))
+                return id;
+        }
+        return std::nullopt;
     }
-    ImGui::Begin("Graph Visualization");
-    ImNodes::BeginNodeEditor();
+    for (const auto &[id, node] : graph.nodes)
+    {
+        if (ImNodes::IsNodeSelected(id))
+            return id;
+    }
+    return std::nullopt;
+}
+
+// Видимые статьи и кластеры пересчитываются только после загрузки графа или раскрытия кластера
+static void rebuildClusterView(Graph &graph)
+{
+    visiblePages.clear();
+    visibleClusters.clear();
+    visibleLinks.clear();
+
+    std::unordered_map<int, int> degree;
+    for (auto &[from, to] : graph.edges)
+    {
+        ++degree[from];
+        ++degree[to];
+    }
+
+    std::unordered_map<int, int> representative;
+    std::unordered_map<int, std::size_t> clusterSlot;
+    std::unordered_map<int, int> clusterLabelDegree;
     for (auto &[id, node] : graph.nodes)
     {
-        ImNodes::BeginNode(id);
-        node.position = node.position.value_or(nodePositions[id]);
-        ImNodes::SetNodeGridSpacePos(node.id, *node.position);
+        auto key = graph.clusters.collapsedAncestor(id, expandedClusters);
+        if (!key)
+        {
+            representative[id] = id;
+            visiblePages.push_back(id);
+            continue;
+        }
+
+        int clusterId = -(graph.clusters.flatIndex(*key) + 1);
+        representative[id] = clusterId;
+        auto [slot, inserted] = clusterSlot.try_emplace(clusterId, visibleClusters.size());
+        if (inserted)
+        {
+            visibleClusters.push_back({clusterId, *key, 0, "", ImVec2(0.0f, 0.0f)});
+        }
+        auto &cluster = visibleClusters[slot->second];
+        ImVec2 position = node.position.value_or(nodePositions[id]);
+        cluster.position.x += position.x;
+        cluster.position.y += position.y;
+        ++cluster.size;
+
+        // Кластер подписывается самой связанной статьёй
+        auto [best, first] = clusterLabelDegree.try_emplace(clusterId, degree[id]);
+        if (first || degree[id] > best->second)
+        {
+            best->second = degree[id];
+            cluster.label = node.label;
+        }
+    }
+    for (auto &cluster : visibleClusters)
+    {
+        cluster.position.x /= cluster.size;
+        cluster.position.y /= cluster.size;
+    }
+
+    std::map<std::pair<int, int>, int> weights;
+    for (auto &[from, to] : graph.edges)
+    {
+        int a = representative[from];
+        int b = representative[to];
+        if (a != b)
+            ++weights[{a, b}];
+    }
+    for (auto &[link, weight] : weights)
+    {
+        visibleLinks.push_back({link.first, link.second, weight});
+    }
+    clusterViewDirty = false;
+}
+
+static char query[256] = "";
+static std::vector<TitleMatch> matches;
+
+static void renderSearch(Graph &graph)
+{
+    static double searchMs = 0.0;
+
+    ImGui::Begin("Search");
+    if (ImGui::InputText("##query", query, sizeof(query)))
+    {
+        PROFILE_SCOPE("Search");
+        auto begin = std::chrono::steady_clock::now();
+        matches = graph.searchTitles(query, 20);
+        searchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+    if (query[0] != '\0')
+    {
+        ImGui::Text("%zu results (%.3f ms)", matches.size(), searchMs);
+    }
+    for (auto &match : matches)
+    {
+        std::string clear_name = match.name;
+        std::replace(clear_name.begin(), clear_name.end(), '_', ' ');
+        if (ImGui::Selectable((clear_name + " (" + std::to_string(match.visitors) + ")").c_str()))
+        {
+            if (auto id = graph.resolveTitle(match))
+            {
+                loadSubGraph(graph, *id);
+                query[0] = '\0';
+                matches.clear();
+            }
+            else
+            {
+                // Статьи больше нет в текущих данных: показываем результаты по новому индексу
+                matches = graph.searchTitles(query, 20);
+            }
+            break;
+        }
+    }
+    ImGui::End();
+}
+
+static void drawPageNode(int id, Node &node)
+{
+    ImNodes::BeginNode(id);
+    node.position = node.position.value_or(nodePositions[id]);
+    ImNodes::SetNodeGridSpacePos(node.id, *node.position);
+
+    ImGui::Text("%s", node.label.c_str());
+
+    ImNodes::BeginInputAttribute(id * 2);
+    ImGui::Text("From");
+    ImNodes::EndInputAttribute();
+
+    ImNodes::BeginOutputAttribute(id * 2 + 1);
+    ImGui::Text("To");
+    ImNodes::EndOutputAttribute();
+
+    ImNodes::EndNode();
+}
+
+static void drawClusterView(Graph &graph)
+{
+    if (clusterViewDirty)
+    {
+        rebuildClusterView(graph);
+    }
+
+    for (int id : visiblePages)
+    {
+        drawPageNode(id, graph.nodes[id]);
+    }
+    for (auto &cluster : visibleClusters)
+    {
+        ImNodes::BeginNode(cluster.id);
+        ImNodes::SetNodeGridSpacePos(cluster.id, cluster.position);
 
-        ImGui::Text("%s", node.label.c_str());
+        ImNodes::BeginNodeTitleBar();
+        ImGui::Text("%s", cluster.label.c_str());
+        ImNodes::EndNodeTitleBar();
+        ImGui::Text("%d pages", cluster.size);
 
-        ImNodes::BeginInputAttribute(id * 2);
+        ImNodes::BeginInputAttribute(cluster.id * 2);
         ImGui::Text("From");
         ImNodes::EndInputAttribute();
 
-        ImNodes::BeginOutputAttribute(id * 2 + 1);
+        ImNodes::BeginOutputAttribute(cluster.id * 2 + 1);
         ImGui::Text("To");
         ImNodes::EndOutputAttribute();
 
@@ -98,20 +299,111 @@ void renderGraph(Graph &graph)
     }
 
     int linkId = 0;
-    for (auto &[from, to] : graph.edges)
+    for (auto &link : visibleLinks)
+    {
+        ImNodes::PushStyleVar(ImNodesStyleVar_LinkThickness, 2.0f + 1.5f * std::log2(static_cast<float>(link.weight)));
+        ImNodes::Link(linkId++, link.from * 2 + 1, link.to * 2);
+        ImNodes::PopStyleVar();
+    }
+}
+
+static void drawGraph(Graph &graph)
+{
+    PROFILE_SCOPE("Draw");
+    ImGui::Begin("Graph Visualization");
+    ImNodes::BeginNodeEditor();
+    if (clusterViewActive(graph))
     {
+        drawClusterView(graph);
+    }
+    else
+    {
+        for (auto &[id, node] : graph.nodes)
+        {
+            drawPageNode(id, node);
+        }
 
-        ImNodes::Link(linkId++, from * 2 + 1, to * 2);
+        int linkId = 0;
+        for (auto &[from, to] : graph.edges)
+        {
+
+            ImNodes::Link(linkId++, from * 2 + 1, to * 2);
+        }
     }
     ImNodes::EndNodeEditor();
     ImGui::End();
+}
+
+static void renderViewControls(Graph &graph)
+{
+    ImGui::Begin("View");
+    ImGui::SliderInt("First level", &graph.firstLevelLimit, 1, 300);
+    ImGui::SliderInt("Second level", &graph.secondLevelLimit, 0, 6);
+    if (ImGui::Button("Reload"))
+    {
+        loadSubGraph(graph, centerNodeId);
+    }
+
+    // Последнее значение слайдера — текущие данные, остальные — сохранённые поколения
+    const auto &generations = graph.history.generations();
+    if (!generations.empty())
+    {
+        int live = static_cast<int>(generations.size());
+        int selected = graph.history.position() ? static_cast<int>(*graph.history.position()) : live;
+        std::string label = selected == live ? "live" : generations[selected].date;
+        if (ImGui::SliderInt("Date", &selected, 0, live, label.c_str()))
+        {
+            // id статей в истории (linktargets) и в текущих данных (wikipediapages) различаются
+            bool keepCenter = graph.history.position() && selected != live;
+            graph.showGeneration(selected == live ? std::nullopt : std::optional<std::size_t>(selected));
+            query[0] = '\0';
+            matches.clear();
+            graph.loadFromDatabase(keepCenter ? std::optional<int>(graph.centerId) : std::nullopt);
+            // Пустой снимок: centerId остался от прежних данных, раскладывать нечего
+            if (!graph.nodes.empty())
+            {
+                currentNodeId = graph.centerId;
+                randomizeNodePositions(graph, graph.centerId);
+            }
+            expandedClusters.clear();
+            clusterViewDirty = true;
+        }
+    }
+    if (ImGui::Checkbox("Cluster view", &clusterViewEnabled))
+    {
+        clusterViewDirty = true;
+    }
+    ImGui::Text("%zu pages, %zu links, %d cluster levels", graph.nodes.size(), graph.edges.size(), graph.clusters.levels());
+    if (clusterViewActive(graph))
+    {
+        ImGui::Text("%zu clusters visible, double-click to expand", visibleClusters.size());
+        if (ImGui::Button("Collapse all"))
+        {
+            expandedClusters.clear();
+            clusterViewDirty = true;
+        }
+    }
+    ImGui::End();
+}
+
+void renderGraph(Graph &graph)
+{
+    if (graph.nodes.empty())
+    {
+        loadSubGraph(graph, currentNodeId);
+    }
+    renderSearch(graph);
+    renderViewControls(graph);
+    drawGraph(graph);
+    static std::vector<std::string> outlinks;
     if (ImGui::IsMouseClicked(ImGuiMouseButton_Right))
     {
         int hoveredNodeId;
-        if (ImNodes::IsNodeHovered(&hoveredNodeId))
+        if (ImNodes::IsNodeHovered(&hoveredNodeId) && hoveredNodeId >= 0)
         {
             ImGui::OpenPopup("NeighborPopup");
             currentNodeId = hoveredNodeId;
+            outlinks = graph.getOutlinks(currentNodeId);
         }
     }
 
@@ -141,6 +433,17 @@ void renderGraph(Graph &graph)
             ImGui::EndListBox();
         }
 
+        // Все ссылки статьи, включая непопулярные (pageoutlinks)
+        ImGui::Text("All links: %d", static_cast<int>(outlinks.size()));
+        if (!outlinks.empty() && ImGui::BeginListBox("##outlinks", ImVec2(300, 150)))
+        {
+            for (const auto &name : outlinks)
+            {
+                ImGui::TextUnformatted(name.c_str());
+            }
+            ImGui::EndListBox();
+        }
+
         // Добавляем кнопку "Открыть в браузере"
         if (ImGui::Button("Open in Browser"))
         {
@@ -164,26 +467,41 @@ void renderGraph(Graph &graph)
         ImGui::EndPopup();
     }
 
-    for (auto &[id, node] : graph.nodes)
+    if (auto id = selectedPage(graph))
     {
-        if (ImNodes::IsNodeSelected(id))
+        graph.nodes[*id].position = ImNodes::GetNodeGridSpacePos(*id);
+    }
+    if (clusterViewActive(graph))
+    {
+        for (auto &cluster : visibleClusters)
         {
-            node.position = ImNodes::GetNodeGridSpacePos(id);
-            break;
+            if (ImNodes::IsNodeSelected(cluster.id))
+            {
+                cluster.position = ImNodes::GetNodeGridSpacePos(cluster.id);
+            }
         }
     }
 
     if (ImGui::IsMouseDoubleClicked(0))
     {
-        for (auto &[id, node] : graph.nodes)
+        if (clusterViewActive(graph))
         {
-            if (ImNodes::IsNodeSelected(id))
+            for (auto &cluster : visibleClusters)
             {
-                using namespace std::chrono_literals;
-                std::this_thread::sleep_for(100ms);
-                loadSubGraph(graph, id);
-                break;
+                if (ImNodes::IsNodeSelected(cluster.id))
+                {
+                    expandedClusters.insert(cluster.key);
+                    clusterViewDirty = true;
+                    ImNodes::ClearNodeSelection();
+                    return;
+                }
             }
         }
+        if (auto id = selectedPage(graph))
+        {
+            using namespace std::chrono_literals;
+            std::this_thread::sleep_for(100ms);
+            loadSubGraph(graph, *id);
+        }
     }
 }
@@ -11,10 +11,28 @@
 #include <iomanip>
 #include <chrono>
 #include <thread>
+#include <atomic>
 #include <ctime>
+#include <random>
+#include <functional>
 #include "parser/consts.h"
+#include "parser/work_queue.h"
+#include "parser/link_store.h"
+#include "parser/history.h"
+#include "parser/request_scheduler.h"
+#include "parser/neighbor_table.h"
 
 std::unordered_map<std::string, int> page_map;
+link_store::Dictionary link_dictionary;
+RequestScheduler scheduler;
+
+std::unique_ptr<sql::Connection> open_connection()
+{
+    sql::mysql::MySQL_Driver *driver = sql::mysql::get_mysql_driver_instance();
+    std::unique_ptr<sql::Connection> conn(driver->connect(db::db_host, db::db_user, db::db_pass));
+    conn->setSchema(db::db_name);
+    return conn;
+}
 
 std::string url_encode(const std::string &value)
 {
@@ -33,36 +51,15 @@ std::string url_encode(const std::string &value)
     return encoded.str();
 }
 
-size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::string *output)
-{
-    size_t total_size = size * nmemb;
-    output->append((char *)contents, total_size);
-    return total_size;
-}
-
 std::string fetch_url(const std::string &url)
 {
-    CURL *curl = curl_easy_init();
-    if (!curl)
+    auto response = scheduler.fetch(url);
+    if (!response.ok)
     {
-        std::cerr << "cURL initialization error" << std::endl;
+        std::cerr << "Request failed (" << response.error << "): " << url << std::endl;
         return "";
     }
-
-    std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK)
-    {
-        std::cerr << "cURL error: " << curl_easy_strerror(res) << std::endl;
-    }
-
-    curl_easy_cleanup(curl);
-    return response;
+    return response.body;
 }
 
 std::vector<std::tuple<int, std::string, int, int>> fetch_top_articles()
@@ -148,27 +145,77 @@ void insert_reference(int page_id, int referenced_page_id)
     }
 }
 
-void parse_references(const std::string &text, int page_id)
+// Название цели ссылки в том виде, в каком его отдаёт API: "Barack_Obama"
+std::string normalize_link(const std::string &target)
 {
-    std::regex reference_regex(R"(\[\[(?:[^\]|]*\|)?([^\]]+)\]\])");
-    std::smatch match;
-    std::string content = text;
-    while (std::regex_search(content, match, reference_regex))
+    static const char *const skipped_namespaces[] = {
+        "file", "image", "category", "template", "wikipedia", "help", "portal", "draft", "module", "special", "talk", "user", "wp", "wikt"};
+
+    auto begin = target.find_first_not_of(' ');
+    if (begin == std::string::npos)
+        return "";
+    auto end = target.find_last_not_of(' ');
+    std::string name = target.substr(begin, end - begin + 1);
+
+    auto colon = name.find(':');
+    if (colon == 0)
+        return "";
+    if (colon != std::string::npos)
     {
-        std::string ref_name = match[1].str();
-        std::replace(ref_name.begin(), ref_name.end(), ' ', '_');
+        std::string prefix = name.substr(0, colon);
+        std::transform(prefix.begin(), prefix.end(), prefix.begin(), [](unsigned char ch)
+                       { return static_cast<char>(std::tolower(ch)); });
+        for (const auto *ns : skipped_namespaces)
+        {
+            if (prefix == ns)
+                return "";
+        }
+    }
 
-        if (page_map.count(ref_name))
+    std::replace(name.begin(), name.end(), ' ', '_');
+    name[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(name[0])));
+    return name;
+}
+
+bool parse_references(const std::string &text, int page_id)
+{
+    // Захватывается цель ссылки, а не подпись после '|' и не якорь после '#'
+    static const std::regex reference_regex(R"(\[\[([^\[\]|#]*)(?:#[^\[\]|]*)?(?:\|[^\[\]]*)?\]\])");
+    std::vector<std::string> outlinks;
+    for (auto it = std::sregex_iterator(text.begin(), text.end(), reference_regex); it != std::sregex_iterator(); ++it)
+    {
+        std::string ref_name = normalize_link((*it)[1].str());
+        if (ref_name.empty())
+            continue;
+
+        auto target = page_map.find(ref_name);
+        if (target != page_map.end())
         {
-            insert_reference(page_id, page_map[ref_name]);
+            insert_reference(page_id, target->second);
         }
-        content = match.suffix().str();
+        outlinks.push_back(std::move(ref_name));
+    }
+
+    try
+    {
+        auto conn = open_connection();
+        return link_store::save_outlinks(*conn, link_dictionary, page_id, outlinks);
+    }
+    catch (sql::SQLException &e)
+    {
+        std::cerr << "MySQL Error (parse_references): " << e.what() << std::endl;
     }
+    return false;
 }
 
-void fetch_and_parse_article(const std::string &title)
+// false, если статью не удалось загрузить или сохранить
+bool fetch_and_parse_article(const std::string &title)
 {
-    std::string url = "https://en.wikipedia.org/w/api.php?action=query&titles=" + url_encode(title) + "&prop=revisions&rvprop=content&rvslots=main&format=json";
+    auto page = page_map.find(title);
+    if (page == page_map.end())
+        return false;
+
+    std::string url = "https://en.wikipedia.org/w/api.php?action=query&titles=" + url_encode(title) + "&prop=revisions&rvprop=content&rvslots=main&format=json&maxlag=" + std::to_string(rate::maxlag_seconds);
     std::string json_data = fetch_url(url);
 
     Json::CharReaderBuilder builder;
@@ -178,32 +225,65 @@ void fetch_and_parse_article(const std::string &title)
     if (!Json::parseFromStream(builder, stream, &root, &errs))
     {
         std::cerr << "JSON parsing error: " << errs << std::endl;
-        return;
+        return false;
+    }
+    if (!root.isMember("query"))
+    {
+        std::cerr << "API error for " << title << ": " << root["error"]["info"].asString() << std::endl;
+        return false;
     }
 
+    bool saved = true;
     const auto &pages = root["query"]["pages"];
     for (const auto &entry : pages)
     {
         if (entry["revisions"].isArray() && !entry["revisions"].empty())
         {
             std::string content = entry["revisions"][0]["slots"]["main"]["*"].asString();
-            parse_references(content, page_map[title]);
+            saved = parse_references(content, page->second) && saved;
         }
     }
+    return saved;
 }
 
-void process_articles()
+// Статьи разбираются в нескольких потоках, а число одновременных запросов
+// ограничивает планировщик
+void for_each_article(std::size_t size, const std::function<void(std::size_t)> &process)
+{
+    std::atomic<std::size_t> next{0};
+    std::vector<std::thread> threads;
+    std::size_t count = std::min<std::size_t>(rate::max_concurrency, size);
+    for (std::size_t t = 0; t < count; ++t)
+    {
+        threads.emplace_back([&]
+                             {
+            sql::mysql::MySQL_Driver *driver = sql::mysql::get_mysql_driver_instance();
+            driver->threadInit();
+            for (std::size_t i = next++; i < size; i = next++)
+            {
+                process(i);
+            }
+            driver->threadEnd(); });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+std::size_t process_articles()
 {
     std::vector<std::tuple<int, std::string, int, int>> top_articles = fetch_top_articles();
 
+    std::vector<std::string> titles;
     for (const auto &[id, title, visitors, volume] : top_articles)
     {
         insert_page(id, title, visitors, volume);
+        titles.push_back(title);
     }
-    for (const auto &[id, title, visitors, volume] : top_articles)
-    {
-        fetch_and_parse_article(title);
-    }
+    for_each_article(titles.size(), [&](std::size_t i)
+                     { fetch_and_parse_article(titles[i]); });
+    return titles.size();
 }
 
 void delete_old_entries()
@@ -233,6 +313,9 @@ void delete_old_references()
         std::unique_ptr<sql::Statement> stmt(conn->createStatement());
 
         stmt->execute("DELETE FROM pagereferences WHERE created_at < NOW() - INTERVAL 1 DAY");
+        stmt->execute("DELETE FROM pageoutlinks WHERE created_at < NOW() - INTERVAL 1 DAY");
+        // Готовые списки ссылаются на id вчерашних статей и пересобираются в конце цикла
+        stmt->execute("TRUNCATE TABLE pageneighbors");
     }
     catch (sql::SQLException &e)
     {
@@ -240,8 +323,236 @@ void delete_old_references()
     }
 }
 
-int main()
+int current_cycle_id()
+{
+    std::time_t t = std::time(nullptr) - utils::seconds_in_day;
+    std::tm *now = std::localtime(&t);
+    return (now->tm_year + 1900) * 10000 + (now->tm_mon + 1) * 100 + now->tm_mday;
+}
+
+void load_page_map(sql::Connection &conn)
+{
+    page_map.clear();
+    try
+    {
+        std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+        std::unique_ptr<sql::ResultSet> res(stmt->executeQuery("SELECT id, name FROM wikipediapages"));
+        while (res->next())
+        {
+            page_map[res->getString(2)] = res->getInt(1);
+        }
+    }
+    catch (sql::SQLException &e)
+    {
+        std::cerr << "MySQL Error (load_page_map): " << e.what() << std::endl;
+    }
+}
+
+void record_history(int cycle_id)
+{
+    try
+    {
+        auto conn = open_connection();
+        history::record_generation(*conn, link_dictionary, cycle_id);
+    }
+    catch (sql::SQLException &e)
+    {
+        std::cerr << "MySQL Error (record_history): " << e.what() << std::endl;
+    }
+}
+
+void rebuild_neighbors()
 {
+    try
+    {
+        auto conn = open_connection();
+        neighbor_table::rebuild(*conn);
+    }
+    catch (sql::SQLException &e)
+    {
+        std::cerr << "MySQL Error (rebuild_neighbors): " << e.what() << std::endl;
+    }
+}
+
+// Пустой цикл (просмотры за вчера ещё не опубликованы или кончился бюджет
+// повторов) не записывается: иначе история получила бы дельту, удаляющую весь
+// граф, а на следующий день - дельту, возвращающую его обратно
+void finish_cycle(int cycle_id, std::size_t articles)
+{
+    if (articles == 0)
+    {
+        std::cerr << "No articles fetched for cycle " << cycle_id << ", skipping history and neighbors" << std::endl;
+        return;
+    }
+    record_history(cycle_id);
+    rebuild_neighbors();
+}
+
+// Ставит статьи цикла в очередь и ждёт, пока воркеры её разберут. Соединение
+// открывается на каждый цикл (за сутки простоя сервер его закрывает) и
+// переоткрывается после ошибки базы
+void dispatch_cycle(int cycle_id, const std::vector<std::string> &titles)
+{
+    bool queued = false;
+    while (true)
+    {
+        try
+        {
+            auto conn = open_connection();
+            if (!queued)
+            {
+                queued = work_queue::enqueue_cycle(*conn, cycle_id, titles);
+                if (queued)
+                    std::cout << "Queued " << titles.size() << " articles for cycle " << cycle_id << std::endl;
+            }
+            while (queued)
+            {
+                work_queue::reap_expired(*conn);
+                int left = work_queue::remaining(*conn, cycle_id);
+                if (left == 0)
+                    return;
+                if (left < 0)
+                    break;
+                std::cout << left << " articles left in queue" << std::endl;
+                std::this_thread::sleep_for(std::chrono::seconds(work::idle_poll_seconds));
+            }
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (dispatch_cycle): " << e.what() << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(work::idle_poll_seconds));
+    }
+}
+
+// Координатор: сохраняет список статей цикла и раздаёт их воркерам через очередь
+void run_coordinator()
+{
+    std::cout << "Starting coordinator" << std::endl;
+
+    while (true)
+    {
+        std::cout << "Updating database..." << std::endl;
+        delete_old_entries();
+        delete_old_references();
+        scheduler.begin_cycle();
+
+        std::vector<std::string> titles;
+        for (const auto &[id, title, visitors, volume] : fetch_top_articles())
+        {
+            insert_page(id, title, visitors, volume);
+            titles.push_back(title);
+        }
+
+        int cycle_id = current_cycle_id();
+        dispatch_cycle(cycle_id, titles);
+        finish_cycle(cycle_id, titles.size());
+        std::cout << "Update complete. Sleeping for 24 hours..." << std::endl;
+
+        std::this_thread::sleep_for(std::chrono::hours(24));
+    }
+}
+
+// Воркер: забирает пакеты статей из общей очереди, пока она не опустеет
+void run_worker(const std::string &owner)
+{
+    std::cout << "Starting worker " << owner << std::endl;
+    std::unique_ptr<sql::Connection> conn;
+    int loaded_cycle = 0;
+
+    while (true)
+    {
+        std::vector<work_queue::Task> tasks;
+        try
+        {
+            // После ошибки базы (например, перезапуска MySQL) соединение открывается заново
+            if (!conn)
+                conn = open_connection();
+            tasks = work_queue::claim_batch(*conn, owner, work::batch_size);
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (run_worker): " << e.what() << std::endl;
+            conn.reset();
+        }
+        if (tasks.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(work::idle_poll_seconds));
+            continue;
+        }
+
+        // Новый цикл: координатор уже записал свежий список статей
+        if (tasks.front().cycle_id != loaded_cycle)
+        {
+            if (loaded_cycle)
+                scheduler.report();
+            scheduler.begin_cycle();
+            load_page_map(*conn);
+            loaded_cycle = tasks.front().cycle_id;
+        }
+
+        // Повторы и паузы планировщика могут растянуть пакет дольше аренды, поэтому
+        // аренда статьи продлевается перед загрузкой, а результат записывается сразу
+        for_each_article(tasks.size(), [&](std::size_t i)
+                         {
+            const auto &task = tasks[i];
+            try
+            {
+                auto task_conn = open_connection();
+                work_queue::renew(*task_conn, task.id, owner);
+                if (fetch_and_parse_article(task.title))
+                    work_queue::complete(*task_conn, task.id, owner);
+                else
+                    work_queue::release(*task_conn, task.id, owner);
+            }
+            catch (sql::SQLException &e)
+            {
+                std::cerr << "MySQL Error (run_worker): " << e.what() << std::endl;
+            } });
+    }
+}
+
+std::string default_worker_name()
+{
+    std::random_device rd;
+    std::ostringstream name;
+    name << "worker-" << std::hex << rd();
+    return name.str();
+}
+
+void ensure_schema()
+{
+    try
+    {
+        auto conn = open_connection();
+        work_queue::ensure_schema(*conn);
+        link_store::ensure_schema(*conn);
+        history::ensure_schema(*conn);
+        neighbor_table::ensure_schema(*conn);
+    }
+    catch (sql::SQLException &e)
+    {
+        std::cerr << "MySQL Error (ensure_schema): " << e.what() << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    ensure_schema();
+
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--coordinator")
+    {
+        run_coordinator();
+        return 0;
+    }
+    if (mode == "--worker")
+    {
+        run_worker(argc > 2 ? argv[2] : default_worker_name());
+        return 0;
+    }
+
     std::cout << "Starting Wikipedia data processing daemon" << std::endl;
 
     while (true)
@@ -249,7 +560,11 @@ int main()
         std::cout << "Updating database..." << std::endl;
         delete_old_entries();
         delete_old_references();
-        process_articles();
+        int cycle_id = current_cycle_id();
+        scheduler.begin_cycle();
+        std::size_t articles = process_articles();
+        scheduler.report();
+        finish_cycle(cycle_id, articles);
         std::cout << "Update complete. Sleeping for 24 hours..." << std::endl;
 
         std::this_thread::sleep_for(std::chrono::hours(24)); // Ожидание 24 часа
@@ -0,0 +1,70 @@
+#include "adjacency.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace adjacency
+{
+    namespace
+    {
+        void put_varint(std::string &out, std::uint32_t value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back(static_cast<char>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        bool get_varint(std::string_view blob, std::size_t &pos, std::uint32_t &value)
+        {
+            value = 0;
+            for (int shift = 0; pos < blob.size() && shift < 35; shift += 7)
+            {
+                auto byte = static_cast<unsigned char>(blob[pos++]);
+                value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+    }
+
+    std::string encode(std::vector<int> ids)
+    {
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        std::string blob;
+        blob.reserve(ids.size() * 2 + 4);
+        put_varint(blob, static_cast<std::uint32_t>(ids.size()));
+        std::uint32_t previous = 0;
+        for (int id : ids)
+        {
+            put_varint(blob, static_cast<std::uint32_t>(id) - previous);
+            previous = static_cast<std::uint32_t>(id);
+        }
+        return blob;
+    }
+
+    std::vector<int> decode(std::string_view blob)
+    {
+        std::size_t pos = 0;
+        std::uint32_t count;
+        if (!get_varint(blob, pos, count))
+            return {};
+
+        std::vector<int> ids;
+        ids.reserve(std::min<std::size_t>(count, blob.size()));
+        std::uint32_t current = 0;
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            std::uint32_t delta;
+            if (!get_varint(blob, pos, delta))
+                break;
+            current += delta;
+            ids.push_back(static_cast<int>(current));
+        }
+        return ids;
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Сжатый список смежности: количество, затем разности между соседними
+// отсортированными id, всё в varint (7 бит на байт).
+namespace adjacency
+{
+    std::string encode(std::vector<int> ids);
+    std::vector<int> decode(std::string_view blob);
+}
@@ -18,4 +18,35 @@ namespace js
 namespace utils
 {
     inline constexpr auto const seconds_in_day = 24 * 60 * 60;
-}
\ No newline at end of file
+}
+
+namespace work
+{
+    inline constexpr auto const batch_size = 20;        // Статей за один захват очереди
+    inline constexpr auto const lease_seconds = 300;    // Время аренды пакета воркером
+    inline constexpr auto const max_attempts = 3;       // После этого задача помечается failed
+    inline constexpr auto const idle_poll_seconds = 10; // Пауза, если очередь пуста
+}
+
+namespace snapshots
+{
+    inline constexpr auto const checkpoint_interval = 7; // Полный снимок раз в 7 поколений
+}
+
+namespace neighbors
+{
+    inline constexpr auto const max_per_page = 500; // Длина готового списка соседей в pageneighbors
+}
+
+namespace rate
+{
+    inline constexpr auto const initial_concurrency = 2;
+    inline constexpr auto const max_concurrency = 16;
+    inline constexpr auto const max_attempts = 5;
+    inline constexpr auto const retry_budget = 200;      // Повторов на один цикл
+    inline constexpr auto const backoff_base_ms = 500;
+    inline constexpr auto const backoff_cap_ms = 60000;
+    inline constexpr auto const latency_factor = 3.0;    // Во сколько раз ответ медленнее базового, чтобы снизить нагрузку
+    inline constexpr auto const maxlag_seconds = 5;
+    inline constexpr auto const user_agent = "WikipediaTools/1.0 (https://github.com/drunckat/WikipediaTools)";
+}
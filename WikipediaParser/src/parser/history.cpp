@@ -0,0 +1,422 @@
+#include "history.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <jdbc/cppconn/prepared_statement.h>
+#include <jdbc/cppconn/resultset.h>
+#include <jdbc/cppconn/statement.h>
+#include "consts.h"
+#include "sql_utils.h"
+
+namespace history
+{
+    namespace
+    {
+        constexpr std::size_t chunk = 500;
+
+        using PageChange = std::tuple<int, std::optional<int>, std::optional<int>>; // title_id, before, after
+        using EdgeChange = std::tuple<int, int, bool>;                            // title_id, referenced, added
+        using OutlinkChange = std::pair<int, std::optional<std::string>>;         // title_id, новый список или NULL
+
+        template <typename Row, typename Bind>
+        void insert_rows(sql::Connection &conn, const std::string &head, const std::string &row, int columns, const std::vector<Row> &rows, Bind bind)
+        {
+            for (std::size_t begin = 0; begin < rows.size(); begin += chunk)
+            {
+                std::size_t count = std::min(chunk, rows.size() - begin);
+                std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(head + sql_utils::placeholders(count, row)));
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    bind(*stmt, static_cast<int>(i) * columns + 1, rows[begin + i]);
+                }
+                stmt->execute();
+            }
+        }
+
+        // Блобы передаются потоками, которые должны жить до execute()
+        void insert_blobs(sql::Connection &conn, const std::string &table, int generation_id, const std::vector<OutlinkChange> &rows)
+        {
+            for (std::size_t begin = 0; begin < rows.size(); begin += chunk)
+            {
+                std::size_t count = std::min(chunk, rows.size() - begin);
+                std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(
+                    "INSERT INTO " + table + " (generation_id, title_id, links) VALUES " + sql_utils::placeholders(count, "(?, ?, ?)")));
+                std::vector<std::unique_ptr<std::istringstream>> streams;
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    const auto &[title_id, links] = rows[begin + i];
+                    int index = static_cast<int>(i) * 3 + 1;
+                    stmt->setInt(index, generation_id);
+                    stmt->setInt(index + 1, title_id);
+                    if (links)
+                    {
+                        streams.push_back(std::make_unique<std::istringstream>(*links));
+                        stmt->setBlob(index + 2, streams.back().get());
+                    }
+                    else
+                        stmt->setNull(index + 2, sql::DataType::VARBINARY);
+                }
+                stmt->execute();
+            }
+        }
+
+        std::string read_blob(sql::ResultSet &res, int column)
+        {
+            std::unique_ptr<std::istream> blob(res.getBlob(column));
+            return {std::istreambuf_iterator<char>(*blob), std::istreambuf_iterator<char>()};
+        }
+
+        void set_optional(sql::PreparedStatement &stmt, int index, std::optional<int> value)
+        {
+            if (value)
+                stmt.setInt(index, *value);
+            else
+                stmt.setNull(index, sql::DataType::INTEGER);
+        }
+
+        int query_int(sql::Connection &conn, const std::string &query)
+        {
+            std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+            std::unique_ptr<sql::ResultSet> res(stmt->executeQuery(query));
+            return res->next() ? res->getInt(1) : 0;
+        }
+
+        int query_int(sql::Connection &conn, const std::string &query, int argument)
+        {
+            std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(query));
+            stmt->setInt(1, argument);
+            std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
+            return res->next() ? res->getInt(1) : 0;
+        }
+
+        // Текущее состояние из рабочих таблиц, id статей переведены в id словаря
+        State current_state(sql::Connection &conn, link_store::Dictionary &dictionary)
+        {
+            std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+
+            std::unordered_map<int, std::string> names;
+            std::vector<std::pair<std::string, int>> pages;
+            std::unique_ptr<sql::ResultSet> page_rows(stmt->executeQuery("SELECT id, name, visitors_last_5_days FROM wikipediapages"));
+            while (page_rows->next())
+            {
+                names[page_rows->getInt(1)] = page_rows->getString(2);
+                pages.emplace_back(page_rows->getString(2), page_rows->getInt(3));
+            }
+
+            std::vector<std::string> titles;
+            titles.reserve(pages.size());
+            for (const auto &[name, visitors] : pages)
+            {
+                titles.push_back(name);
+            }
+            dictionary.resolve(conn, titles);
+
+            State state;
+            for (const auto &[name, visitors] : pages)
+            {
+                if (auto id = dictionary.lookup(name))
+                    state.visitors[*id] = visitors;
+            }
+
+            std::unique_ptr<sql::ResultSet> edge_rows(stmt->executeQuery("SELECT page_id, referenced_page_id FROM pagereferences"));
+            while (edge_rows->next())
+            {
+                auto from = names.find(edge_rows->getInt(1));
+                auto to = names.find(edge_rows->getInt(2));
+                if (from == names.end() || to == names.end())
+                    continue;
+                auto from_id = dictionary.lookup(from->second);
+                auto to_id = dictionary.lookup(to->second);
+                if (from_id && to_id)
+                    state.edges.emplace(*from_id, *to_id);
+            }
+
+            std::unique_ptr<sql::ResultSet> outlink_rows(stmt->executeQuery("SELECT page_id, links FROM pageoutlinks"));
+            while (outlink_rows->next())
+            {
+                auto page = names.find(outlink_rows->getInt(1));
+                if (page == names.end())
+                    continue;
+                if (auto id = dictionary.lookup(page->second))
+                    state.outlinks[*id] = read_blob(*outlink_rows, 2);
+            }
+            return state;
+        }
+    }
+
+    void ensure_schema(sql::Connection &conn)
+    {
+        try
+        {
+            std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS generations ("
+                "id INT AUTO_INCREMENT PRIMARY KEY, "
+                "cycle_id INT NOT NULL, "
+                "is_checkpoint BOOLEAN NOT NULL, "
+                "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+                "UNIQUE KEY uq_cycle (cycle_id))");
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS generationpages ("
+                "generation_id INT NOT NULL, "
+                "title_id INT NOT NULL, "
+                "visitors_before INT NULL, "
+                "visitors_after INT NULL, "
+                "PRIMARY KEY (generation_id, title_id))");
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS generationedges ("
+                "generation_id INT NOT NULL, "
+                "title_id INT NOT NULL, "
+                "referenced_title_id INT NOT NULL, "
+                "added BOOLEAN NOT NULL, "
+                "PRIMARY KEY (generation_id, title_id, referenced_title_id))");
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS generationoutlinks ("
+                "generation_id INT NOT NULL, "
+                "title_id INT NOT NULL, "
+                "links MEDIUMBLOB NULL, "
+                "PRIMARY KEY (generation_id, title_id), "
+                "KEY idx_title (title_id, generation_id))");
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS checkpointpages ("
+                "generation_id INT NOT NULL, "
+                "title_id INT NOT NULL, "
+                "visitors INT NOT NULL, "
+                "PRIMARY KEY (generation_id, title_id))");
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS checkpointedges ("
+                "generation_id INT NOT NULL, "
+                "title_id INT NOT NULL, "
+                "referenced_title_id INT NOT NULL, "
+                "PRIMARY KEY (generation_id, title_id, referenced_title_id))");
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS checkpointoutlinks ("
+                "generation_id INT NOT NULL, "
+                "title_id INT NOT NULL, "
+                "links MEDIUMBLOB NOT NULL, "
+                "PRIMARY KEY (generation_id, title_id))");
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (history::ensure_schema): " << e.what() << std::endl;
+        }
+    }
+
+    State load_state(sql::Connection &conn, int generation_id)
+    {
+        State state;
+        int checkpoint = query_int(conn, "SELECT COALESCE(MAX(id), 0) FROM generations WHERE id <= ? AND is_checkpoint", generation_id);
+
+        if (checkpoint)
+        {
+            std::unique_ptr<sql::PreparedStatement> pages(conn.prepareStatement(
+                "SELECT title_id, visitors FROM checkpointpages WHERE generation_id = ?"));
+            pages->setInt(1, checkpoint);
+            std::unique_ptr<sql::ResultSet> page_rows(pages->executeQuery());
+            while (page_rows->next())
+            {
+                state.visitors[page_rows->getInt(1)] = page_rows->getInt(2);
+            }
+
+            std::unique_ptr<sql::PreparedStatement> edges(conn.prepareStatement(
+                "SELECT title_id, referenced_title_id FROM checkpointedges WHERE generation_id = ?"));
+            edges->setInt(1, checkpoint);
+            std::unique_ptr<sql::ResultSet> edge_rows(edges->executeQuery());
+            while (edge_rows->next())
+            {
+                state.edges.emplace(edge_rows->getInt(1), edge_rows->getInt(2));
+            }
+
+            std::unique_ptr<sql::PreparedStatement> outlinks(conn.prepareStatement(
+                "SELECT title_id, links FROM checkpointoutlinks WHERE generation_id = ?"));
+            outlinks->setInt(1, checkpoint);
+            std::unique_ptr<sql::ResultSet> outlink_rows(outlinks->executeQuery());
+            while (outlink_rows->next())
+            {
+                state.outlinks[outlink_rows->getInt(1)] = read_blob(*outlink_rows, 2);
+            }
+        }
+
+        std::unique_ptr<sql::PreparedStatement> pages(conn.prepareStatement(
+            "SELECT title_id, visitors_after FROM generationpages "
+            "WHERE generation_id > ? AND generation_id <= ? ORDER BY generation_id"));
+        pages->setInt(1, checkpoint);
+        pages->setInt(2, generation_id);
+        std::unique_ptr<sql::ResultSet> page_rows(pages->executeQuery());
+        while (page_rows->next())
+        {
+            if (page_rows->isNull(2))
+                state.visitors.erase(page_rows->getInt(1));
+            else
+                state.visitors[page_rows->getInt(1)] = page_rows->getInt(2);
+        }
+
+        std::unique_ptr<sql::PreparedStatement> edges(conn.prepareStatement(
+            "SELECT title_id, referenced_title_id, added FROM generationedges "
+            "WHERE generation_id > ? AND generation_id <= ? ORDER BY generation_id"));
+        edges->setInt(1, checkpoint);
+        edges->setInt(2, generation_id);
+        std::unique_ptr<sql::ResultSet> edge_rows(edges->executeQuery());
+        while (edge_rows->next())
+        {
+            std::pair<int, int> edge{edge_rows->getInt(1), edge_rows->getInt(2)};
+            if (edge_rows->getInt(3))
+                state.edges.insert(edge);
+            else
+                state.edges.erase(edge);
+        }
+
+        std::unique_ptr<sql::PreparedStatement> outlinks(conn.prepareStatement(
+            "SELECT title_id, links FROM generationoutlinks "
+            "WHERE generation_id > ? AND generation_id <= ? ORDER BY generation_id"));
+        outlinks->setInt(1, checkpoint);
+        outlinks->setInt(2, generation_id);
+        std::unique_ptr<sql::ResultSet> outlink_rows(outlinks->executeQuery());
+        while (outlink_rows->next())
+        {
+            if (outlink_rows->isNull(2))
+                state.outlinks.erase(outlink_rows->getInt(1));
+            else
+                state.outlinks[outlink_rows->getInt(1)] = read_blob(*outlink_rows, 2);
+        }
+        return state;
+    }
+
+    void record_generation(sql::Connection &conn, link_store::Dictionary &dictionary, int cycle_id)
+    {
+        try
+        {
+            if (query_int(conn, "SELECT COUNT(*) FROM generations WHERE cycle_id = ?", cycle_id))
+            {
+                std::cout << "Generation for cycle " << cycle_id << " is already recorded" << std::endl;
+                return;
+            }
+
+            int previous_id = query_int(conn, "SELECT COALESCE(MAX(id), 0) FROM generations");
+            int since_checkpoint = query_int(conn,
+                                             "SELECT COUNT(*) FROM generations WHERE id > "
+                                             "(SELECT COALESCE(MAX(id), 0) FROM generations WHERE is_checkpoint)");
+            bool checkpoint = previous_id == 0 || since_checkpoint + 1 >= snapshots::checkpoint_interval;
+
+            State previous = previous_id ? load_state(conn, previous_id) : State{};
+            State next = current_state(conn, dictionary);
+            if (next.visitors.empty())
+            {
+                std::cerr << "No pages for cycle " << cycle_id << ", generation is not recorded" << std::endl;
+                return;
+            }
+
+            std::vector<PageChange> page_changes;
+            for (const auto &[id, visitors] : next.visitors)
+            {
+                auto before = previous.visitors.find(id);
+                if (before == previous.visitors.end())
+                    page_changes.emplace_back(id, std::nullopt, visitors);
+                else if (before->second != visitors)
+                    page_changes.emplace_back(id, before->second, visitors);
+            }
+            for (const auto &[id, visitors] : previous.visitors)
+            {
+                if (!next.visitors.count(id))
+                    page_changes.emplace_back(id, visitors, std::nullopt);
+            }
+
+            std::vector<EdgeChange> edge_changes;
+            for (const auto &edge : next.edges)
+            {
+                if (!previous.edges.count(edge))
+                    edge_changes.emplace_back(edge.first, edge.second, true);
+            }
+            for (const auto &edge : previous.edges)
+            {
+                if (!next.edges.count(edge))
+                    edge_changes.emplace_back(edge.first, edge.second, false);
+            }
+
+            // Блоб канонический (отсортированные уникальные id), поэтому равенство
+            // байтов означает тот же список ссылок
+            std::vector<OutlinkChange> outlink_changes;
+            for (const auto &[id, links] : next.outlinks)
+            {
+                auto before = previous.outlinks.find(id);
+                if (before == previous.outlinks.end() || before->second != links)
+                    outlink_changes.emplace_back(id, links);
+            }
+            for (const auto &[id, links] : previous.outlinks)
+            {
+                if (!next.outlinks.count(id))
+                    outlink_changes.emplace_back(id, std::nullopt);
+            }
+
+            conn.setAutoCommit(false);
+            try
+            {
+                std::unique_ptr<sql::PreparedStatement> insert(conn.prepareStatement(
+                    "INSERT INTO generations (cycle_id, is_checkpoint) VALUES (?, ?)"));
+                insert->setInt(1, cycle_id);
+                insert->setInt(2, checkpoint ? 1 : 0);
+                insert->execute();
+                std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+                std::unique_ptr<sql::ResultSet> res(stmt->executeQuery("SELECT LAST_INSERT_ID()"));
+                res->next();
+                int generation_id = res->getInt(1);
+
+                insert_rows(conn, "INSERT INTO generationpages (generation_id, title_id, visitors_before, visitors_after) VALUES ", "(?, ?, ?, ?)", 4, page_changes,
+                            [generation_id](sql::PreparedStatement &s, int i, const PageChange &row)
+                            {
+                                s.setInt(i, generation_id);
+                                s.setInt(i + 1, std::get<0>(row));
+                                set_optional(s, i + 2, std::get<1>(row));
+                                set_optional(s, i + 3, std::get<2>(row));
+                            });
+                insert_rows(conn, "INSERT INTO generationedges (generation_id, title_id, referenced_title_id, added) VALUES ", "(?, ?, ?, ?)", 4, edge_changes,
+                            [generation_id](sql::PreparedStatement &s, int i, const EdgeChange &row)
+                            {
+                                s.setInt(i, generation_id);
+                                s.setInt(i + 1, std::get<0>(row));
+                                s.setInt(i + 2, std::get<1>(row));
+                                s.setInt(i + 3, std::get<2>(row) ? 1 : 0);
+                            });
+                insert_blobs(conn, "generationoutlinks", generation_id, outlink_changes);
+
+                if (checkpoint)
+                {
+                    std::vector<std::pair<int, int>> pages(next.visitors.begin(), next.visitors.end());
+                    std::vector<std::pair<int, int>> edges(next.edges.begin(), next.edges.end());
+                    auto bind_pair = [generation_id](sql::PreparedStatement &s, int i, const std::pair<int, int> &row)
+                    {
+                        s.setInt(i, generation_id);
+                        s.setInt(i + 1, row.first);
+                        s.setInt(i + 2, row.second);
+                    };
+                    insert_rows(conn, "INSERT INTO checkpointpages (generation_id, title_id, visitors) VALUES ", "(?, ?, ?)", 3, pages, bind_pair);
+                    insert_rows(conn, "INSERT INTO checkpointedges (generation_id, title_id, referenced_title_id) VALUES ", "(?, ?, ?)", 3, edges, bind_pair);
+                    std::vector<OutlinkChange> outlinks(next.outlinks.begin(), next.outlinks.end());
+                    insert_blobs(conn, "checkpointoutlinks", generation_id, outlinks);
+                }
+                conn.commit();
+
+                std::cout << "Recorded generation " << generation_id << (checkpoint ? " (checkpoint)" : "") << ": "
+                          << page_changes.size() << " page changes, " << edge_changes.size() << " edge changes, "
+                          << outlink_changes.size() << " outlink changes" << std::endl;
+            }
+            catch (sql::SQLException &)
+            {
+                conn.rollback();
+                conn.setAutoCommit(true);
+                throw;
+            }
+            conn.setAutoCommit(true);
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (record_generation): " << e.what() << std::endl;
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <jdbc/mysql_connection.h>
+#include "link_store.h"
+
+// История графа по дням. Каждое поколение хранит только изменения относительно
+// предыдущего (generationpages, generationedges, generationoutlinks); раз в
+// checkpoint_interval поколений дополнительно пишется полный снимок (checkpoint*).
+// Статьи идентифицируются id из linktargets, которые не меняются между днями.
+// Все исходящие ссылки (pageoutlinks) меняются постатейно: в дельту попадает
+// новый сжатый список статьи целиком.
+namespace history
+{
+    struct State
+    {
+        std::unordered_map<int, int> visitors; // title_id -> visitors_last_5_days
+        std::set<std::pair<int, int>> edges;   // (title_id, referenced title_id)
+        std::unordered_map<int, std::string> outlinks; // title_id -> список ссылок в формате adjacency
+    };
+
+    void ensure_schema(sql::Connection &conn);
+    State load_state(sql::Connection &conn, int generation_id);
+    void record_generation(sql::Connection &conn, link_store::Dictionary &dictionary, int cycle_id);
+}
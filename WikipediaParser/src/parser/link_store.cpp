@@ -0,0 +1,128 @@
+#include "link_store.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <jdbc/cppconn/prepared_statement.h>
+#include <jdbc/cppconn/resultset.h>
+#include <jdbc/cppconn/statement.h>
+#include "adjacency.h"
+#include "sql_utils.h"
+
+namespace link_store
+{
+    namespace
+    {
+        constexpr std::size_t chunk = 500;
+    }
+
+    std::vector<int> Dictionary::resolve(sql::Connection &conn, const std::vector<std::string> &names)
+    {
+        // Запросы к базе идут без блокировки, чтобы потоки разбора не ждали друг друга
+        std::vector<std::string> missing;
+        {
+            std::lock_guard lock(mutex);
+            for (const auto &name : names)
+            {
+                if (!ids.count(name))
+                    missing.push_back(name);
+            }
+        }
+        std::sort(missing.begin(), missing.end());
+        missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+        for (std::size_t begin = 0; begin < missing.size(); begin += chunk)
+        {
+            std::size_t count = std::min(chunk, missing.size() - begin);
+
+            std::unique_ptr<sql::PreparedStatement> insert(conn.prepareStatement(
+                "INSERT IGNORE INTO linktargets (name) VALUES " + sql_utils::placeholders(count, "(?)")));
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                insert->setString(static_cast<int>(i + 1), missing[begin + i]);
+            }
+            insert->execute();
+
+            std::unique_ptr<sql::PreparedStatement> select(conn.prepareStatement(
+                "SELECT id, name FROM linktargets WHERE name IN (" + sql_utils::placeholders(count, "?") + ")"));
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                select->setString(static_cast<int>(i + 1), missing[begin + i]);
+            }
+            std::unique_ptr<sql::ResultSet> res(select->executeQuery());
+            std::lock_guard lock(mutex);
+            while (res->next())
+            {
+                ids[res->getString(2)] = res->getInt(1);
+            }
+        }
+
+        std::lock_guard lock(mutex);
+        std::vector<int> result;
+        result.reserve(names.size());
+        for (const auto &name : names)
+        {
+            auto it = ids.find(name);
+            if (it != ids.end())
+                result.push_back(it->second);
+        }
+        return result;
+    }
+
+    std::optional<int> Dictionary::lookup(const std::string &name) const
+    {
+        std::lock_guard lock(mutex);
+        auto it = ids.find(name);
+        if (it == ids.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    void ensure_schema(sql::Connection &conn)
+    {
+        try
+        {
+            std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS linktargets ("
+                "id INT AUTO_INCREMENT PRIMARY KEY, "
+                "name VARCHAR(255) CHARACTER SET utf8mb4 COLLATE utf8mb4_bin NOT NULL, "
+                "UNIQUE KEY uq_name (name))");
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS pageoutlinks ("
+                "page_id INT PRIMARY KEY, "
+                "link_count INT NOT NULL, "
+                "links MEDIUMBLOB NOT NULL, "
+                "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP)");
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (link_store::ensure_schema): " << e.what() << std::endl;
+        }
+    }
+
+    bool save_outlinks(sql::Connection &conn, Dictionary &dictionary, int page_id, const std::vector<std::string> &names)
+    {
+        try
+        {
+            auto ids = dictionary.resolve(conn, names);
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+            auto link_count = ids.size();
+            std::istringstream blob_stream(adjacency::encode(std::move(ids)));
+
+            std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(
+                "REPLACE INTO pageoutlinks (page_id, link_count, links) VALUES (?, ?, ?)"));
+            stmt->setInt(1, page_id);
+            stmt->setInt(2, static_cast<int>(link_count));
+            stmt->setBlob(3, &blob_stream);
+            stmt->execute();
+            return true;
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (save_outlinks): " << e.what() << std::endl;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <jdbc/mysql_connection.h>
+
+// Все исходящие ссылки статьи: названия кодируются в id через словарь
+// linktargets, список id хранится сжатым блобом в pageoutlinks.
+namespace link_store
+{
+    class Dictionary
+    {
+    public:
+        std::vector<int> resolve(sql::Connection &conn, const std::vector<std::string> &names);
+        std::optional<int> lookup(const std::string &name) const;
+
+    private:
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, int> ids;
+    };
+
+    void ensure_schema(sql::Connection &conn);
+    bool save_outlinks(sql::Connection &conn, Dictionary &dictionary, int page_id, const std::vector<std::string> &names);
+}
@@ -0,0 +1,149 @@
+#include "neighbor_table.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <jdbc/cppconn/prepared_statement.h>
+#include <jdbc/cppconn/resultset.h>
+#include <jdbc/cppconn/statement.h>
+#include "consts.h"
+#include "sql_utils.h"
+
+namespace neighbor_table
+{
+    namespace
+    {
+        constexpr std::size_t chunk = 500;
+
+        struct Page
+        {
+            std::string name;
+            int visitors;
+        };
+
+        // Сортировка списков независима для каждой статьи, поэтому делится между потоками
+        void rank_all(std::vector<std::pair<int, std::vector<int>>> &lists, const std::unordered_map<int, Page> &pages)
+        {
+            if (lists.empty())
+                return;
+            std::atomic<std::size_t> next{0};
+            std::vector<std::thread> threads;
+            std::size_t count = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, lists.size());
+            for (std::size_t t = 0; t < count; ++t)
+            {
+                threads.emplace_back([&]
+                                     {
+                    for (std::size_t i = next++; i < lists.size(); i = next++)
+                    {
+                        auto &ids = lists[i].second;
+                        auto by_visitors = [&](int a, int b)
+                        {
+                            int va = pages.at(a).visitors;
+                            int vb = pages.at(b).visitors;
+                            return va != vb ? va > vb : a < b;
+                        };
+                        std::size_t keep = std::min<std::size_t>(ids.size(), neighbors::max_per_page);
+                        std::partial_sort(ids.begin(), ids.begin() + keep, ids.end(), by_visitors);
+                        ids.resize(keep);
+                    } });
+            }
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+        }
+    }
+
+    void ensure_schema(sql::Connection &conn)
+    {
+        try
+        {
+            std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS pageneighbors ("
+                "page_id INT NOT NULL, "
+                "neighbor_rank INT NOT NULL, "
+                "neighbor_id INT NOT NULL, "
+                "name VARCHAR(255) NOT NULL, "
+                "visitors INT NOT NULL, "
+                "PRIMARY KEY (page_id, neighbor_rank))");
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (neighbor_table::ensure_schema): " << e.what() << std::endl;
+        }
+    }
+
+    void rebuild(sql::Connection &conn)
+    {
+        std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+
+        std::unordered_map<int, Page> pages;
+        std::unique_ptr<sql::ResultSet> page_rows(stmt->executeQuery("SELECT id, name, visitors_last_5_days FROM wikipediapages"));
+        while (page_rows->next())
+        {
+            pages[page_rows->getInt(1)] = Page{page_rows->getString(2), page_rows->getInt(3)};
+        }
+
+        std::unordered_map<int, std::size_t> index;
+        std::vector<std::pair<int, std::vector<int>>> lists;
+        std::unique_ptr<sql::ResultSet> ref_rows(stmt->executeQuery("SELECT page_id, referenced_page_id FROM pagereferences"));
+        while (ref_rows->next())
+        {
+            int page_id = ref_rows->getInt(1);
+            int referenced = ref_rows->getInt(2);
+            if (!pages.count(page_id) || !pages.count(referenced))
+                continue;
+            auto [it, inserted] = index.try_emplace(page_id, lists.size());
+            if (inserted)
+                lists.emplace_back(page_id, std::vector<int>{});
+            lists[it->second].second.push_back(referenced);
+        }
+
+        rank_all(lists, pages);
+
+        // Таблица собирается рядом и подменяется целиком, чтобы читатели не видели
+        // наполовину записанный список
+        stmt->execute("DROP TABLE IF EXISTS pageneighbors_next");
+        stmt->execute("CREATE TABLE pageneighbors_next LIKE pageneighbors");
+
+        std::vector<std::pair<int, int>> rows; // индекс в lists, ранг соседа
+        for (std::size_t l = 0; l < lists.size(); ++l)
+        {
+            for (std::size_t rank = 0; rank < lists[l].second.size(); ++rank)
+            {
+                rows.emplace_back(static_cast<int>(l), static_cast<int>(rank));
+            }
+        }
+        for (std::size_t begin = 0; begin < rows.size(); begin += chunk)
+        {
+            std::size_t count = std::min(chunk, rows.size() - begin);
+            std::unique_ptr<sql::PreparedStatement> insert(conn.prepareStatement(
+                "INSERT INTO pageneighbors_next (page_id, neighbor_rank, neighbor_id, name, visitors) VALUES " +
+                sql_utils::placeholders(count, "(?, ?, ?, ?, ?)")));
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const auto &[list, rank] = rows[begin + i];
+                int neighbor = lists[list].second[rank];
+                const auto &page = pages.at(neighbor);
+                int column = static_cast<int>(i) * 5;
+                insert->setInt(column + 1, lists[list].first);
+                insert->setInt(column + 2, rank);
+                insert->setInt(column + 3, neighbor);
+                insert->setString(column + 4, page.name);
+                insert->setInt(column + 5, page.visitors);
+            }
+            insert->execute();
+        }
+
+        // pageneighbors_old мог остаться от прерванной подмены, иначе RENAME не пройдёт
+        stmt->execute("DROP TABLE IF EXISTS pageneighbors_old");
+        stmt->execute("RENAME TABLE pageneighbors TO pageneighbors_old, pageneighbors_next TO pageneighbors");
+        stmt->execute("DROP TABLE pageneighbors_old");
+        std::cout << "Ranked neighbors for " << lists.size() << " pages (" << rows.size() << " rows)" << std::endl;
+    }
+}
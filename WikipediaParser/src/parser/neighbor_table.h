@@ -0,0 +1,13 @@
+#pragma once
+
+#include <jdbc/mysql_connection.h>
+
+// Готовые списки соседей для WikipediaGraph. В конце цикла для каждой статьи
+// её ссылки сортируются по посещаемости и записываются в pageneighbors с
+// ключом (page_id, neighbor_rank), так что чтение соседей - это просмотр
+// диапазона первичного ключа без JOIN и сортировки.
+namespace neighbor_table
+{
+    void ensure_schema(sql::Connection &conn);
+    void rebuild(sql::Connection &conn);
+}
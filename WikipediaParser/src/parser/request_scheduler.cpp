@@ -0,0 +1,223 @@
+#include "request_scheduler.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <curl/curl.h>
+
+namespace
+{
+    struct Transfer
+    {
+        std::string body;
+        long status = 0;
+        double first_byte_seconds = 0.0;
+        std::chrono::seconds retry_after{0};
+        bool maxlag = false;
+        CURLcode code = CURLE_OK;
+    };
+
+    size_t write_body(void *contents, size_t size, size_t nmemb, std::string *output)
+    {
+        size_t total_size = size * nmemb;
+        output->append((char *)contents, total_size);
+        return total_size;
+    }
+
+    size_t read_header(char *buffer, size_t size, size_t nitems, Transfer *transfer)
+    {
+        size_t total_size = size * nitems;
+        std::string line(buffer, total_size);
+        auto colon = line.find(':');
+        if (colon != std::string::npos)
+        {
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char ch)
+                           { return static_cast<char>(std::tolower(ch)); });
+            std::string value = line.substr(colon + 1);
+            if (name == "retry-after")
+            {
+                // Retry-After в виде HTTP-даты не разбираем, тогда работает обычная задержка
+                try
+                {
+                    transfer->retry_after = std::chrono::seconds(std::stoi(value));
+                }
+                catch (std::exception const &)
+                {
+                }
+            }
+            else if (name == "mediawiki-api-error" && value.find("maxlag") != std::string::npos)
+            {
+                transfer->maxlag = true;
+            }
+        }
+        return total_size;
+    }
+
+    Transfer perform(const std::string &url)
+    {
+        Transfer transfer;
+        CURL *curl = curl_easy_init();
+        if (!curl)
+        {
+            transfer.code = static_cast<CURLcode>(-1);
+            return transfer;
+        }
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_body);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer.body);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, read_header);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer);
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "gzip");
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, rate::user_agent);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
+
+        transfer.code = curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &transfer.status);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &transfer.first_byte_seconds);
+        curl_easy_cleanup(curl);
+        return transfer;
+    }
+
+    std::chrono::milliseconds backoff(int attempt)
+    {
+        thread_local std::mt19937 rng(std::random_device{}());
+        long long cap = std::min<long long>(rate::backoff_cap_ms, static_cast<long long>(rate::backoff_base_ms) << std::min(attempt, 16));
+        std::uniform_int_distribution<long long> jitter(cap / 2, cap);
+        return std::chrono::milliseconds(jitter(rng));
+    }
+}
+
+RequestScheduler::Response RequestScheduler::fetch(const std::string &url)
+{
+    Response response;
+    for (int attempt = 0;; ++attempt)
+    {
+        acquire();
+        Transfer transfer = perform(url);
+
+        bool transport_error = transfer.code != CURLE_OK;
+        bool throttled = transfer.status == 429 || transfer.status == 503 || transfer.maxlag;
+        bool server_error = transfer.status >= 500;
+        Outcome outcome = throttled ? Outcome::throttled : (transport_error || server_error ? Outcome::failed : Outcome::success);
+        release(outcome, transfer.first_byte_seconds, transfer.retry_after);
+
+        response.status = transfer.status;
+        response.body = std::move(transfer.body);
+        if (transport_error)
+            response.error = curl_easy_strerror(transfer.code);
+        else if (transfer.maxlag)
+            response.error = "maxlag";
+        else if (transfer.status >= 400)
+            response.error = "HTTP " + std::to_string(transfer.status);
+        else
+            response.error.clear();
+
+        bool retryable = transport_error || throttled || server_error;
+        if (!retryable)
+        {
+            response.ok = transfer.status < 400;
+            return response;
+        }
+        if (attempt + 1 >= rate::max_attempts || !take_retry())
+        {
+            std::lock_guard lock(mutex);
+            ++failures;
+            return response;
+        }
+
+        auto delay = std::max<std::chrono::milliseconds>(backoff(attempt), transfer.retry_after);
+        std::this_thread::sleep_for(delay);
+    }
+}
+
+void RequestScheduler::begin_cycle()
+{
+    std::lock_guard lock(mutex);
+    retries_left = rate::retry_budget;
+    requests = retries = throttles = failures = 0;
+}
+
+void RequestScheduler::report() const
+{
+    std::lock_guard lock(mutex);
+    std::cout << "Requests: " << requests << ", retries: " << retries << ", throttled: " << throttles
+              << ", failed: " << failures << ", concurrency limit: " << static_cast<int>(limit) << std::endl;
+}
+
+void RequestScheduler::acquire()
+{
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        auto now = Clock::now();
+        if (now < paused_until)
+        {
+            slots.wait_until(lock, paused_until);
+            continue;
+        }
+        if (in_flight < static_cast<int>(limit))
+            break;
+        slots.wait(lock);
+    }
+    ++in_flight;
+    ++requests;
+}
+
+void RequestScheduler::release(Outcome outcome, double first_byte_seconds, std::chrono::seconds retry_after)
+{
+    {
+        std::lock_guard lock(mutex);
+        --in_flight;
+        auto now = Clock::now();
+
+        if (outcome == Outcome::throttled)
+        {
+            ++throttles;
+            decrease(now);
+            if (retry_after.count() > 0)
+                paused_until = std::max(paused_until, now + retry_after);
+        }
+        else if (outcome == Outcome::success)
+        {
+            if (baseline > 0.0 && first_byte_seconds > baseline * rate::latency_factor)
+            {
+                decrease(now);
+            }
+            else
+            {
+                // +1 к пределу за каждые limit успешных ответов
+                limit = std::min<double>(rate::max_concurrency, limit + 1.0 / limit);
+            }
+            // Базовое время быстро следует вниз и медленно вверх
+            if (baseline == 0.0 || first_byte_seconds < baseline)
+                baseline = first_byte_seconds;
+            else
+                baseline += (first_byte_seconds - baseline) * 0.01;
+        }
+    }
+    slots.notify_all();
+}
+
+void RequestScheduler::decrease(Clock::time_point now)
+{
+    // Не чаще раза за время ответа: сигналы от уже отправленных запросов относятся к старому пределу
+    auto window = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(std::max(baseline, 0.5)));
+    if (now - last_decrease < window)
+        return;
+    limit = std::max(1.0, limit / 2.0);
+    last_decrease = now;
+}
+
+bool RequestScheduler::take_retry()
+{
+    std::lock_guard lock(mutex);
+    if (retries_left <= 0)
+        return false;
+    --retries_left;
+    ++retries;
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include "consts.h"
+
+// Планировщик запросов к Wikimedia. Число одновременных запросов подбирается
+// по AIMD: растёт на единицу за "окно" успешных ответов и делится пополам
+// при 429/503/maxlag или заметном росте времени ответа. Временные ошибки
+// повторяются с экспоненциальной задержкой со случайным разбросом, пока не
+// исчерпан бюджет повторов на цикл.
+class RequestScheduler
+{
+public:
+    struct Response
+    {
+        std::string body;
+        long status = 0;
+        bool ok = false;
+        std::string error;
+    };
+
+    Response fetch(const std::string &url);
+    void begin_cycle();
+    void report() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Outcome
+    {
+        success,
+        throttled,
+        failed
+    };
+
+    void acquire();
+    void release(Outcome outcome, double first_byte_seconds, std::chrono::seconds retry_after);
+    void decrease(Clock::time_point now);
+    bool take_retry();
+
+    mutable std::mutex mutex;
+    std::condition_variable slots;
+    double limit = rate::initial_concurrency;
+    int in_flight = 0;
+    double baseline = 0.0; // Типичное время до первого байта, секунды
+    Clock::time_point last_decrease;
+    Clock::time_point paused_until;
+
+    int retries_left = rate::retry_budget;
+    int requests = 0;
+    int retries = 0;
+    int throttles = 0;
+    int failures = 0;
+};
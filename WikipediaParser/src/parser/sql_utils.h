@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+namespace sql_utils
+{
+    // "?, ?, ?" или "(?, ?), (?, ?)" для многострочных запросов
+    inline std::string placeholders(std::size_t count, const std::string &row)
+    {
+        std::string result;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (i)
+                result += ", ";
+            result += row;
+        }
+        return result;
+    }
+}
@@ -0,0 +1,211 @@
+#include "work_queue.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <jdbc/cppconn/prepared_statement.h>
+#include <jdbc/cppconn/resultset.h>
+#include <jdbc/cppconn/statement.h>
+#include "consts.h"
+#include "sql_utils.h"
+
+namespace work_queue
+{
+    void ensure_schema(sql::Connection &conn)
+    {
+        try
+        {
+            std::unique_ptr<sql::Statement> stmt(conn.createStatement());
+            stmt->execute(
+                "CREATE TABLE IF NOT EXISTS parsequeue ("
+                "id INT AUTO_INCREMENT PRIMARY KEY, "
+                "cycle_id INT NOT NULL, "
+                "title VARCHAR(255) NOT NULL, "
+                "status ENUM('pending', 'leased', 'done', 'failed') NOT NULL DEFAULT 'pending', "
+                "lease_owner VARCHAR(64) NULL, "
+                "lease_expires_at TIMESTAMP NULL, "
+                "attempts INT NOT NULL DEFAULT 0, "
+                "UNIQUE KEY uq_cycle_title (cycle_id, title), "
+                "KEY idx_cycle_status (cycle_id, status, lease_expires_at))");
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (ensure_schema): " << e.what() << std::endl;
+        }
+    }
+
+    bool enqueue_cycle(sql::Connection &conn, int cycle_id, const std::vector<std::string> &titles)
+    {
+        try
+        {
+            std::unique_ptr<sql::PreparedStatement> cleanup(conn.prepareStatement(
+                "DELETE FROM parsequeue WHERE cycle_id < ?"));
+            cleanup->setInt(1, cycle_id);
+            cleanup->execute();
+
+            // Повторный запуск в тот же день сбрасывает задачи цикла
+            constexpr std::size_t chunk = 500;
+            for (std::size_t begin = 0; begin < titles.size(); begin += chunk)
+            {
+                std::size_t count = std::min(chunk, titles.size() - begin);
+                std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(
+                    "INSERT INTO parsequeue (cycle_id, title) VALUES " + sql_utils::placeholders(count, "(?, ?)") +
+                    " ON DUPLICATE KEY UPDATE status = 'pending', lease_owner = NULL, lease_expires_at = NULL, attempts = 0"));
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    stmt->setInt(static_cast<int>(2 * i + 1), cycle_id);
+                    stmt->setString(static_cast<int>(2 * i + 2), titles[begin + i]);
+                }
+                stmt->execute();
+            }
+            return true;
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (enqueue_cycle): " << e.what() << std::endl;
+        }
+        return false;
+    }
+
+    std::vector<Task> claim_batch(sql::Connection &conn, const std::string &owner, int batch_size)
+    {
+        std::vector<Task> tasks;
+        try
+        {
+            conn.setAutoCommit(false);
+            std::unique_ptr<sql::PreparedStatement> select(conn.prepareStatement(
+                "SELECT id, cycle_id, title FROM parsequeue "
+                "WHERE cycle_id = (SELECT MAX(cycle_id) FROM parsequeue) "
+                "AND attempts < ? "
+                "AND (status = 'pending' OR (status = 'leased' AND lease_expires_at < NOW())) "
+                "ORDER BY id LIMIT ? FOR UPDATE SKIP LOCKED"));
+            select->setInt(1, work::max_attempts);
+            select->setInt(2, batch_size);
+            std::unique_ptr<sql::ResultSet> res(select->executeQuery());
+            while (res->next())
+            {
+                tasks.push_back({res->getInt(1), res->getInt(2), res->getString(3)});
+            }
+
+            if (!tasks.empty())
+            {
+                std::unique_ptr<sql::PreparedStatement> lease(conn.prepareStatement(
+                    "UPDATE parsequeue SET status = 'leased', lease_owner = ?, "
+                    "lease_expires_at = NOW() + INTERVAL ? SECOND, attempts = attempts + 1 "
+                    "WHERE id IN (" + sql_utils::placeholders(tasks.size(), "?") + ")"));
+                lease->setString(1, owner);
+                lease->setInt(2, work::lease_seconds);
+                for (std::size_t i = 0; i < tasks.size(); ++i)
+                {
+                    lease->setInt(static_cast<int>(i + 3), tasks[i].id);
+                }
+                lease->execute();
+            }
+            conn.commit();
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (claim_batch): " << e.what() << std::endl;
+            // На оборванном соединении откат тоже бросает исключение; наружу
+            // уходит исходная ошибка, чтобы воркер переподключился
+            try
+            {
+                conn.rollback();
+                conn.setAutoCommit(true);
+            }
+            catch (sql::SQLException &)
+            {
+            }
+            throw;
+        }
+        conn.setAutoCommit(true);
+        return tasks;
+    }
+
+    void complete(sql::Connection &conn, int task_id, const std::string &owner)
+    {
+        try
+        {
+            std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(
+                "UPDATE parsequeue SET status = 'done', lease_expires_at = NULL "
+                "WHERE id = ? AND lease_owner = ?"));
+            stmt->setInt(1, task_id);
+            stmt->setString(2, owner);
+            stmt->execute();
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (complete): " << e.what() << std::endl;
+        }
+    }
+
+    void renew(sql::Connection &conn, int task_id, const std::string &owner)
+    {
+        try
+        {
+            std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(
+                "UPDATE parsequeue SET lease_expires_at = NOW() + INTERVAL ? SECOND "
+                "WHERE id = ? AND status = 'leased' AND lease_owner = ?"));
+            stmt->setInt(1, work::lease_seconds);
+            stmt->setInt(2, task_id);
+            stmt->setString(3, owner);
+            stmt->execute();
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (renew): " << e.what() << std::endl;
+        }
+    }
+
+    void release(sql::Connection &conn, int task_id, const std::string &owner)
+    {
+        try
+        {
+            std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(
+                "UPDATE parsequeue SET status = IF(attempts >= ?, 'failed', 'pending'), "
+                "lease_owner = NULL, lease_expires_at = NULL "
+                "WHERE id = ? AND lease_owner = ?"));
+            stmt->setInt(1, work::max_attempts);
+            stmt->setInt(2, task_id);
+            stmt->setString(3, owner);
+            stmt->execute();
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (release): " << e.what() << std::endl;
+        }
+    }
+
+    void reap_expired(sql::Connection &conn)
+    {
+        try
+        {
+            std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(
+                "UPDATE parsequeue SET status = 'failed' "
+                "WHERE status = 'leased' AND lease_expires_at < NOW() AND attempts >= ?"));
+            stmt->setInt(1, work::max_attempts);
+            stmt->execute();
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (reap_expired): " << e.what() << std::endl;
+        }
+    }
+
+    int remaining(sql::Connection &conn, int cycle_id)
+    {
+        try
+        {
+            std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(
+                "SELECT COUNT(*) FROM parsequeue WHERE cycle_id = ? AND status IN ('pending', 'leased')"));
+            stmt->setInt(1, cycle_id);
+            std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
+            if (res->next())
+                return res->getInt(1);
+        }
+        catch (sql::SQLException &e)
+        {
+            std::cerr << "MySQL Error (remaining): " << e.what() << std::endl;
+        }
+        return -1;
+    }
+}
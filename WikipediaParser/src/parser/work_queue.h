@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <jdbc/mysql_connection.h>
+
+// Общая очередь статей в таблице parsequeue. Воркеры захватывают пакеты через
+// SELECT ... FOR UPDATE SKIP LOCKED и держат их в аренде; просроченная аренда
+// (упавший воркер) снова становится доступна остальным. Статья, которую не
+// удалось загрузить, возвращается в очередь до work::max_attempts попыток.
+namespace work_queue
+{
+    struct Task
+    {
+        int id;
+        int cycle_id;
+        std::string title;
+    };
+
+    void ensure_schema(sql::Connection &conn);
+    bool enqueue_cycle(sql::Connection &conn, int cycle_id, const std::vector<std::string> &titles);
+    std::vector<Task> claim_batch(sql::Connection &conn, const std::string &owner, int batch_size); // Бросает sql::SQLException
+    void renew(sql::Connection &conn, int task_id, const std::string &owner);
+    void complete(sql::Connection &conn, int task_id, const std::string &owner);
+    void release(sql::Connection &conn, int task_id, const std::string &owner);
+    void reap_expired(sql::Connection &conn);
+    int remaining(sql::Connection &conn, int cycle_id); // -1 при ошибке базы
+}